@@ -0,0 +1,83 @@
+// The cost of scheduling through any_executor instead of a template parameter:
+// co_await ex.schedule() in a loop, on an inline executor (whose schedule()
+// never suspends, so all that's left to measure is the dispatch), and on
+// new_thread_context (where every schedule() starts a thread).
+// Build and run with "make bench"; pass an argument to change the number
+// of inline schedules (default 10M; a thousandth of that for new threads).
+
+#include "coro/any_executor.h"
+#include "coro/new_thread_context.h"
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_per(bench_clock::time_point start, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / count;
+}
+
+struct inline_executor {
+    int *count_;
+
+    struct awaitable {
+        int *count_;
+        bool await_ready() noexcept { *count_ += 1; return true; }
+        void await_suspend(std::coroutine_handle<void>) noexcept {}
+        void await_resume() noexcept {}
+    };
+
+    awaitable schedule() noexcept { return awaitable{count_}; }
+    bool running_in_this_thread() const noexcept { return true; }
+};
+
+template<class Ex>
+task<void> templated_loop(Ex ex, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        co_await ex.schedule();
+    }
+}
+
+task<void> erased_loop(any_executor ex, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        co_await ex.schedule();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10'000'000;
+    size_t threads = n / 1000;
+
+    printf("sizeof(any_executor) = %zu, sizeof(any_executor::schedule_awaitable) = %zu\n",
+        sizeof(any_executor), sizeof(any_executor::schedule_awaitable));
+    printf("%-20s %14s %14s\n", "", "templated", "any_executor");
+
+    int count = 0;
+    inline_executor inl{&count};
+    auto start = bench_clock::now();
+    sync_wait(templated_loop(inl, n));
+    double templated = ns_per(start, n);
+    start = bench_clock::now();
+    sync_wait(erased_loop(inl, n));
+    double erased = ns_per(start, n);
+    if (count != int(2 * n)) {
+        printf("wrong count!\n");
+        return 1;
+    }
+    printf("%-20s %12.1fns %12.1fns\n", "inline_executor", templated, erased);
+
+    new_thread_context ctx;
+    start = bench_clock::now();
+    sync_wait(templated_loop(ctx.get_executor(), threads));
+    templated = ns_per(start, threads);
+    start = bench_clock::now();
+    sync_wait(erased_loop(ctx.get_executor(), threads));
+    erased = ns_per(start, threads);
+    printf("%-20s %12.1fns %12.1fns\n", "new_thread_context", templated, erased);
+}
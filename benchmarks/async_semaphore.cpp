@@ -0,0 +1,177 @@
+// Measures async_semaphore's uncontended acquire/release round trip,
+// and its throughput and fairness when many threads fight over few permits.
+// Build and run with "make bench".
+
+#include "coro/async_semaphore.h"
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_since(bench_clock::time_point start, long iterations)
+{
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+task<void> uncontended_loop(async_semaphore& sem, long iterations)
+{
+    for (long i = 0; i < iterations; ++i) {
+        co_await sem.acquire();
+        sem.release();
+    }
+}
+
+void bench_fast_path()
+{
+    const long iterations = 20'000'000;
+    async_semaphore sem(1);
+    auto start = bench_clock::now();
+    sync_wait(uncontended_loop(sem, iterations));
+    printf("uncontended acquire+release:  %6.2f ns/op\n", ns_since(start, iterations));
+
+    std::mutex m;
+    start = bench_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        m.lock();
+        m.unlock();
+    }
+    printf("uncontended std::mutex (ref): %6.2f ns/op\n", ns_since(start, iterations));
+}
+
+static void spin_for(std::chrono::nanoseconds d)
+{
+    auto until = bench_clock::now() + d;
+    while (bench_clock::now() < until) {}
+}
+
+struct detached_task {
+    struct promise_type {
+        detached_task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// A waiter is resumed inline by whoever releases to it. Each contending
+// thread therefore runs a little inbox loop, and every coroutine hops back
+// to its own thread after a contended acquire, the way it would return to
+// its executor in a real program.
+class thread_inbox {
+public:
+    bool await_ready() const noexcept { return std::this_thread::get_id() == owner_; }
+    void await_suspend(std::coroutine_handle<void> h) {
+        std::lock_guard<std::mutex> lock(mut_);
+        queue_.push_back(h);
+        cv_.notify_one();
+    }
+    void await_resume() noexcept {}
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mut_);
+        done_ = true;
+        cv_.notify_one();
+    }
+
+    template<class F>
+    void run(F start) {
+        owner_ = std::this_thread::get_id();
+        start();
+        std::unique_lock<std::mutex> lk(mut_);
+        while (!done_ || !queue_.empty()) {
+            if (queue_.empty()) {
+                cv_.wait(lk);
+                continue;
+            }
+            auto h = queue_.front();
+            queue_.pop_front();
+            lk.unlock();
+            h.resume();
+            lk.lock();
+        }
+    }
+
+private:
+    std::thread::id owner_;
+    std::mutex mut_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<void>> queue_;
+    bool done_ = false;
+};
+
+detached_task contended_loop(async_semaphore& sem, thread_inbox& home, std::atomic<bool>& stop, long *count)
+{
+    while (!stop.load(std::memory_order_relaxed)) {
+        co_await sem.acquire();
+        co_await home;
+        spin_for(std::chrono::nanoseconds(200));
+        ++*count;
+        sem.release();
+    }
+    home.finish();
+}
+
+// Jain's fairness index: 1.0 when every thread got the same share.
+static double jain_index(const std::vector<long>& counts)
+{
+    double sum = 0;
+    double sumsq = 0;
+    for (long c : counts) {
+        sum += c;
+        sumsq += double(c) * c;
+    }
+    return (sum * sum) / (counts.size() * sumsq);
+}
+
+void bench_contention(int nthreads, size_t permits)
+{
+    async_semaphore sem(permits);
+    std::atomic<bool> stop{false};
+    std::vector<long> counts(nthreads * 16);  // padded against false sharing
+    std::vector<thread_inbox> inboxes(nthreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nthreads; ++i) {
+        threads.emplace_back([&, i]() {
+            inboxes[i].run([&, i]() {
+                contended_loop(sem, inboxes[i], stop, &counts[i * 16]);
+            });
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    stop = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<long> perThread;
+    for (int i = 0; i < nthreads; ++i) {
+        perThread.push_back(counts[i * 16]);
+    }
+    long total = 0;
+    for (long c : perThread) total += c;
+    auto [mn, mx] = std::minmax_element(perThread.begin(), perThread.end());
+    printf("%2d threads, %zu permits: %9.0f acquires/s, per-thread min %ld max %ld, fairness %.3f\n",
+        nthreads, permits, total / 0.5, *mn, *mx, jain_index(perThread));
+}
+
+int main()
+{
+    bench_fast_path();
+    int maxThreads = std::max(4u, std::min(16u, std::thread::hardware_concurrency() * 2));
+    for (int n = 2; n <= maxThreads; n *= 2) {
+        bench_contention(n, 1);
+        bench_contention(n, n / 2);
+    }
+}
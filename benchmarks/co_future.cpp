@@ -0,0 +1,115 @@
+// Ping-pong between a coroutine and a responder thread, one future per round
+// trip: co_promise/co_future against the std::future-based awaitable that
+// co_future.h used to provide (one std::async per co_await).
+// Build and run with "make bench"; pass an argument to change the number of
+// native round trips.
+
+#include "coro/co_future.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_per(bench_clock::time_point start, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / count;
+}
+
+// The old co_future::await_suspend: a std::async that waits for the future
+// and then resumes the coroutine. The discarded std::async future blocks
+// in its destructor, so the awaiting thread waits for that, too.
+struct legacy_awaitable {
+    std::future<int> f_;
+
+    bool await_ready() { return f_.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+    void await_suspend(std::coroutine_handle<void> h) {
+        (void)std::async(std::launch::async, [this, h]() {
+            f_.wait();
+            h.resume();
+        });
+    }
+    int await_resume() { return f_.get(); }
+};
+
+// A single-slot mailbox from the coroutine to the responder thread.
+template<class Promise>
+struct mailbox {
+    std::atomic<Promise*> slot_{nullptr};
+    std::atomic<bool> done_{false};
+
+    void post(Promise *p) { slot_.store(p, std::memory_order_release); }
+
+    // Answers every posted promise with its round number.
+    void respond() {
+        for (int i = 0; !done_.load(std::memory_order_acquire); ) {
+            Promise *p = slot_.exchange(nullptr, std::memory_order_acquire);
+            if (p == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            p->set_value(i++);
+        }
+    }
+};
+
+co_future<long> native_pinger(mailbox<co_promise<int>>& box, int rounds)
+{
+    long sum = 0;
+    for (int i = 0; i < rounds; ++i) {
+        co_promise<int> p;
+        co_future<int> f = p.get_future();
+        box.post(&p);
+        sum += co_await f;
+    }
+    box.done_ = true;
+    co_return sum;
+}
+
+co_future<long> legacy_pinger(mailbox<std::promise<int>>& box, int rounds)
+{
+    long sum = 0;
+    for (int i = 0; i < rounds; ++i) {
+        std::promise<int> p;
+        legacy_awaitable a{p.get_future()};
+        box.post(&p);
+        sum += co_await a;
+    }
+    box.done_ = true;
+    co_return sum;
+}
+
+int main(int argc, char **argv)
+{
+    int nativeRounds = (argc > 1) ? atoi(argv[1]) : 1000000;
+    // Each legacy round trip leaves a thread blocked until the whole chain
+    // unwinds, so keep this one short.
+    int legacyRounds = 200;
+
+    auto expected = [](long n) { return n * (n - 1) / 2; };
+
+    mailbox<co_promise<int>> nativeBox;
+    auto start = bench_clock::now();
+    std::thread responder([&]() { nativeBox.respond(); });
+    long nativeSum = native_pinger(nativeBox, nativeRounds).get();
+    responder.join();
+    double nativeNs = ns_per(start, nativeRounds);
+
+    mailbox<std::promise<int>> legacyBox;
+    start = bench_clock::now();
+    responder = std::thread([&]() { legacyBox.respond(); });
+    long legacySum = legacy_pinger(legacyBox, legacyRounds).get();
+    responder.join();
+    double legacyNs = ns_per(start, legacyRounds);
+
+    if (nativeSum != expected(nativeRounds) || legacySum != expected(legacyRounds)) {
+        printf("wrong answer!\n");
+        return 1;
+    }
+    printf("%-28s %12.1fns per round trip (%d rounds)\n", "co_promise/co_future", nativeNs, nativeRounds);
+    printf("%-28s %12.1fns per round trip (%d rounds)\n", "std::future + std::async", legacyNs, legacyRounds);
+    printf("speedup: %.1fx\n", legacyNs / nativeNs);
+}
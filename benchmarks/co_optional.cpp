@@ -0,0 +1,123 @@
+// Chains of 1 to 10 co_await steps in a co_optional coroutine, against the
+// same chains hand-written with "if (!r) return std::nullopt;". Reports ns per
+// chain and heap allocations per chain (counted by replacing operator new).
+// See also "make codegen", which checks the -O2 assembly of the same shapes.
+// Build and run with "make bench"; pass an argument to change the number of inputs.
+
+#include "coro/co_optional.h"
+#include <chrono>
+#include <new>
+#include <optional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+#include <vector>
+
+static size_t allocations = 0;
+
+void *operator new(size_t n)
+{
+    ++allocations;
+    if (void *p = malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+using bench_clock = std::chrono::steady_clock;
+
+// One step of a parse: fails for about one input in a thousand.
+static co_optional<int> co_step(int x, int i)
+{
+    if ((x ^ i) % 1000 == 999) {
+        return std::nullopt;
+    }
+    return x + i;
+}
+
+static std::optional<int> plain_step(int x, int i)
+{
+    if ((x ^ i) % 1000 == 999) {
+        return std::nullopt;
+    }
+    return x + i;
+}
+
+template<int N>
+co_optional<int> co_chain(int x)
+{
+    for (int i = 0; i < N; ++i) {
+        x = co_await co_step(x, i);
+    }
+    co_return x;
+}
+
+template<int N>
+std::optional<int> plain_chain(int x)
+{
+    for (int i = 0; i < N; ++i) {
+        std::optional<int> r = plain_step(x, i);
+        if (!r) {
+            return std::nullopt;
+        }
+        x = *r;
+    }
+    return x;
+}
+
+struct result {
+    double ns;
+    double allocsPerOp;
+    long checksum;
+};
+
+template<class F>
+static result measure(const std::vector<int>& inputs, F f)
+{
+    long checksum = 0;
+    size_t allocsBefore = allocations;
+    auto start = bench_clock::now();
+    for (int x : inputs) {
+        auto r = f(x);
+        checksum += r ? *r : -1;
+    }
+    double ns = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+    double allocs = double(allocations - allocsBefore);
+    return { ns / inputs.size(), allocs / inputs.size(), checksum };
+}
+
+template<int N>
+static bool run_one(const std::vector<int>& inputs)
+{
+    result co = measure(inputs, co_chain<N>);
+    result plain = measure(inputs, plain_chain<N>);
+    printf("%6d %14.2fns %14.2fns %10.2fx %14.2f %14.2f\n", N,
+        co.ns, plain.ns, co.ns / plain.ns, co.allocsPerOp, plain.allocsPerOp);
+    return co.checksum == plain.checksum;
+}
+
+template<int... Ns>
+static bool run_all(const std::vector<int>& inputs, std::integer_sequence<int, Ns...>)
+{
+    return (run_one<Ns + 1>(inputs) & ...);
+}
+
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 1000000;
+    std::vector<int> inputs(count);
+    unsigned seed = 42;
+    for (int& x : inputs) {
+        seed = seed * 1664525 + 1013904223;
+        x = int(seed >> 8);
+    }
+
+    printf("%6s %16s %16s %11s %14s %14s\n", "steps", "co_optional", "hand-written", "ratio", "co allocs/op", "hw allocs/op");
+    if (!run_all(inputs, std::make_integer_sequence<int, 10>())) {
+        printf("checksums differ!\n");
+        return 1;
+    }
+}
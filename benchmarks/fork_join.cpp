@@ -0,0 +1,218 @@
+// Compares fork_join on a work_stealing_pool of 1 to N threads against the same
+// recursion written serially with task<T>: fib(n), a mergesort, and a tree sum.
+// Build and run with "make bench"; pass an argument to change n (e.g. 40).
+
+#include "coro/fork_join.h"
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include "coro/work_stealing_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ms_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+template<class T>
+T run_serial(task<T> t)
+{
+    T result{};
+    sync_wait([&]() -> task<void> { result = co_await std::move(t); }());
+    return result;
+}
+
+void run_serial(task<void> t)
+{
+    sync_wait([&]() -> task<void> { co_await std::move(t); }());
+}
+
+template<class T>
+T run_parallel(work_stealing_pool& pool, fork_task<T> t)
+{
+    T result{};
+    sync_wait([&]() -> task<void> { result = co_await fork_join::run(pool, std::move(t)); }());
+    return result;
+}
+
+void run_parallel(work_stealing_pool& pool, fork_task<void> t)
+{
+    sync_wait([&]() -> task<void> { co_await fork_join::run(pool, std::move(t)); }());
+}
+
+// ----- fib -----
+
+task<long> serial_fib(int n)
+{
+    if (n < 2) {
+        co_return n;
+    }
+    long a = co_await serial_fib(n - 1);
+    long b = co_await serial_fib(n - 2);
+    co_return a + b;
+}
+
+fork_task<long> parallel_fib(int n)
+{
+    if (n < 2) {
+        co_return n;
+    }
+    long a, b;
+    co_await fork_join::spawn(parallel_fib(n - 1), a);
+    co_await fork_join::spawn(parallel_fib(n - 2), b);
+    co_await fork_join::sync();
+    co_return a + b;
+}
+
+// ----- mergesort -----
+
+constexpr size_t sort_cutoff = 2048;
+
+static void merge_halves(int *first, int *mid, int *last, int *scratch)
+{
+    std::merge(first, mid, mid, last, scratch);
+    std::copy(scratch, scratch + (last - first), first);
+}
+
+task<void> serial_sort(int *first, int *last, int *scratch)
+{
+    if (size_t(last - first) <= sort_cutoff) {
+        std::sort(first, last);
+        co_return;
+    }
+    int *mid = first + (last - first) / 2;
+    co_await serial_sort(first, mid, scratch);
+    co_await serial_sort(mid, last, scratch + (mid - first));
+    merge_halves(first, mid, last, scratch);
+}
+
+fork_task<void> parallel_sort(int *first, int *last, int *scratch)
+{
+    if (size_t(last - first) <= sort_cutoff) {
+        std::sort(first, last);
+        co_return;
+    }
+    int *mid = first + (last - first) / 2;
+    co_await fork_join::spawn(parallel_sort(first, mid, scratch));
+    co_await fork_join::spawn(parallel_sort(mid, last, scratch + (mid - first)));
+    co_await fork_join::sync();
+    merge_halves(first, mid, last, scratch);
+}
+
+// ----- tree sum -----
+
+struct Tree {
+    std::unique_ptr<Tree> left;
+    std::unique_ptr<Tree> right;
+    long value;
+};
+
+static std::unique_ptr<Tree> make_tree(int depth, long& next)
+{
+    if (depth == 0) {
+        return nullptr;
+    }
+    auto t = std::make_unique<Tree>();
+    t->left = make_tree(depth - 1, next);
+    t->value = next++;
+    t->right = make_tree(depth - 1, next);
+    return t;
+}
+
+task<long> serial_tree_sum(const Tree *t)
+{
+    if (t == nullptr) {
+        co_return 0;
+    }
+    long l = co_await serial_tree_sum(t->left.get());
+    long r = co_await serial_tree_sum(t->right.get());
+    co_return l + t->value + r;
+}
+
+fork_task<long> parallel_tree_sum(const Tree *t)
+{
+    if (t == nullptr) {
+        co_return 0;
+    }
+    long l, r;
+    co_await fork_join::spawn(parallel_tree_sum(t->left.get()), l);
+    co_await fork_join::spawn(parallel_tree_sum(t->right.get()), r);
+    co_await fork_join::sync();
+    co_return l + t->value + r;
+}
+
+int main(int argc, char **argv)
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 32;
+    std::vector<size_t> threadCounts;
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t k = 1; k < hw; k *= 2) {
+        threadCounts.push_back(k);
+    }
+    threadCounts.push_back(hw);
+
+    std::vector<int> input(1 << 22);
+    std::mt19937 rng(42);
+    for (int& x : input) {
+        x = rng();
+    }
+    std::vector<int> data;
+    std::vector<int> scratch(input.size());
+
+    long next = 1;
+    auto tree = make_tree(20, next);
+
+    auto start = bench_clock::now();
+    long f = run_serial(serial_fib(n));
+    double fibSerial = ms_since(start);
+
+    data = input;
+    start = bench_clock::now();
+    run_serial(serial_sort(data.data(), data.data() + data.size(), scratch.data()));
+    double sortSerial = ms_since(start);
+    if (!std::is_sorted(data.begin(), data.end())) {
+        printf("serial sort failed!\n");
+        return 1;
+    }
+
+    start = bench_clock::now();
+    long sum = run_serial(serial_tree_sum(tree.get()));
+    double treeSerial = ms_since(start);
+
+    printf("%-14s %12s %12s %12s\n", "", "fib(n)", "mergesort", "tree sum");
+    printf("%-14s %10.1fms %10.1fms %10.1fms\n", "serial task<T>", fibSerial, sortSerial, treeSerial);
+
+    for (size_t threads : threadCounts) {
+        work_stealing_pool pool(threads);
+
+        start = bench_clock::now();
+        long pf = run_parallel(pool, parallel_fib(n));
+        double fibParallel = ms_since(start);
+
+        data = input;
+        start = bench_clock::now();
+        run_parallel(pool, parallel_sort(data.data(), data.data() + data.size(), scratch.data()));
+        double sortParallel = ms_since(start);
+
+        start = bench_clock::now();
+        long psum = run_parallel(pool, parallel_tree_sum(tree.get()));
+        double treeParallel = ms_since(start);
+
+        if (pf != f || psum != sum || !std::is_sorted(data.begin(), data.end())) {
+            printf("parallel results differ from serial!\n");
+            return 1;
+        }
+        printf("%2zu-thread pool  %10.1fms %10.1fms %10.1fms   (speedup %.2fx %.2fx %.2fx)\n",
+            threads, fibParallel, sortParallel, treeParallel,
+            fibSerial / fibParallel, sortSerial / sortParallel, treeSerial / treeParallel);
+    }
+    printf("fib(%d) = %ld\n", n, f);
+}
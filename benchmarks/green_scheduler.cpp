@@ -0,0 +1,184 @@
+// The cost of one switch between cooperatively scheduled threads of control,
+// all on one core: green_scheduler's co_await yield_now(), a hand-written
+// round robin of resumable_thing::resume() calls, a ring of swapcontext()
+// fibers, and a ring of OS threads handing a semaphore to one another.
+// Build and run with "make bench"; pass an argument to change the number
+// of switches measured per row (default 20M; a tenth of that for swapcontext,
+// and a hundredth for OS threads).
+
+#include "coro/green_scheduler.h"
+#include "coro/resumable_thing.h"
+#include <chrono>
+#include <memory>
+#include <sched.h>
+#include <semaphore>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <ucontext.h>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_per(bench_clock::time_point start, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / count;
+}
+
+static void report(const char *what, size_t threads, double ns)
+{
+    printf("%-24s %10zu %10.1fns %10.1fM/s\n", what, threads, ns, 1e3 / ns);
+}
+
+// ----- green_scheduler -----
+
+green_thread spinner(long& total, size_t rounds)
+{
+    for (size_t i = 0; i < rounds; ++i) {
+        total += 1;
+        co_await yield_now();
+    }
+}
+
+static double green_switch(size_t threads, size_t switches)
+{
+    long total = 0;
+    green_scheduler sched;
+    for (size_t i = 0; i < threads; ++i) {
+        sched.spawn(spinner(total, switches / threads));
+    }
+    auto start = bench_clock::now();
+    sched.run();
+    return ns_per(start, total);
+}
+
+// ----- resumable_thing, resumed by hand -----
+
+resumable_thing counter(long& total)
+{
+    for (;;) {
+        co_await std::suspend_always{};
+        total += 1;
+    }
+}
+
+static double manual_switch(size_t threads, size_t switches)
+{
+    long total = 0;
+    std::vector<resumable_thing> things;
+    for (size_t i = 0; i < threads; ++i) {
+        things.push_back(counter(total));
+    }
+    auto start = bench_clock::now();
+    for (size_t r = switches / threads; r != 0; --r) {
+        for (resumable_thing& t : things) {
+            t.resume();
+        }
+    }
+    return ns_per(start, total);
+}
+
+// ----- swapcontext -----
+
+// Each fiber swaps straight to the next one in the ring. glibc's
+// swapcontext saves and restores the signal mask, which is a system call.
+struct fiber_ring {
+    static constexpr size_t stack_size = 16 * 1024;
+
+    ucontext_t main_;
+    std::vector<ucontext_t> fibers_;
+    std::unique_ptr<char[]> stacks_;
+    size_t rounds_;
+    long total_ = 0;
+
+    static fiber_ring *current;
+
+    static void body(int i) {
+        fiber_ring& ring = *current;
+        size_t next = (i + 1) % ring.fibers_.size();
+        for (size_t r = 0; r < ring.rounds_; ++r) {
+            ring.total_ += 1;
+            swapcontext(&ring.fibers_[i], &ring.fibers_[next]);
+        }
+        // Fiber 0 finishes first, and returns to main_ via uc_link.
+    }
+
+    explicit fiber_ring(size_t n, size_t rounds) : fibers_(n), stacks_(new char[n * stack_size]), rounds_(rounds) {
+        for (size_t i = 0; i < n; ++i) {
+            getcontext(&fibers_[i]);
+            fibers_[i].uc_stack.ss_sp = &stacks_[i * stack_size];
+            fibers_[i].uc_stack.ss_size = stack_size;
+            fibers_[i].uc_link = &main_;
+            makecontext(&fibers_[i], (void(*)())body, 1, int(i));
+        }
+    }
+};
+
+fiber_ring *fiber_ring::current = nullptr;
+
+static double fiber_switch(size_t threads, size_t switches)
+{
+    fiber_ring ring(threads, switches / threads);
+    fiber_ring::current = &ring;
+    auto start = bench_clock::now();
+    swapcontext(&ring.main_, &ring.fibers_[0]);
+    return ns_per(start, ring.total_);
+}
+
+// ----- OS threads -----
+
+static double thread_switch(size_t threads, size_t switches)
+{
+    size_t rounds = switches / threads;
+    std::vector<std::unique_ptr<std::binary_semaphore>> turn;
+    for (size_t i = 0; i < threads; ++i) {
+        turn.push_back(std::make_unique<std::binary_semaphore>(0));
+    }
+    std::vector<std::thread> ring;
+    for (size_t i = 0; i < threads; ++i) {
+        ring.emplace_back([&, i]() {
+            for (size_t r = 0; r < rounds; ++r) {
+                turn[i]->acquire();
+                turn[(i + 1) % threads]->release();
+            }
+        });
+    }
+    auto start = bench_clock::now();
+    turn[0]->release();
+    for (auto& t : ring) {
+        t.join();
+    }
+    return ns_per(start, rounds * threads);
+}
+
+int main(int argc, char **argv)
+{
+    size_t switches = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 20'000'000;
+
+    // Everything on one core, so that the OS threads really context-switch.
+    cpu_set_t cpus;
+    sched_getaffinity(0, sizeof cpus, &cpus);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &cpus)) {
+        ++cpu;
+    }
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    sched_setaffinity(0, sizeof cpus, &cpus);
+
+    printf("%zu switches per row (%zu for swapcontext, %zu for OS threads), pinned to CPU %d\n",
+        switches, switches / 10, switches / 100, cpu);
+    printf("%-24s %10s %12s %12s\n", "", "threads", "per switch", "switches");
+    for (size_t n : {2, 1000, 1'000'000}) {
+        report("green_scheduler", n, green_switch(n, switches));
+    }
+    for (size_t n : {2, 1000, 1'000'000}) {
+        report("resumable_thing loop", n, manual_switch(n, switches));
+    }
+    for (size_t n : {2, 1000}) {
+        report("swapcontext", n, fiber_switch(n, switches / 10));
+    }
+    for (size_t n : {2, 64}) {
+        report("OS threads", n, thread_switch(n, switches / 100));
+    }
+}
@@ -0,0 +1,166 @@
+// Compares a plain loop of lookups against the same lookups interleaved
+// with co_await prefetch(p), in groups of 1 to 32, on tables much larger
+// than the last-level cache: binary search over a sorted array, and a
+// linear-probing hash table.
+// Build and run with "make bench"; pass an argument to change the
+// size of each table (log2 of its size in bytes, default 30, i.e. 1GiB).
+
+#include "coro/interleave.h"
+#include <chrono>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_per(bench_clock::time_point start, size_t count)
+{
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / count;
+}
+
+static uint64_t hash64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// ----- binary search -----
+
+static size_t plain_lower_bound(const std::vector<uint32_t>& v, uint32_t key)
+{
+    size_t lo = 0;
+    size_t n = v.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        if (v[lo + half] < key) {
+            lo += half;
+        }
+        n -= half;
+    }
+    return lo + (v[lo] < key);
+}
+
+interleaved_task<size_t> interleaved_lower_bound(const std::vector<uint32_t>& v, uint32_t key)
+{
+    size_t lo = 0;
+    size_t n = v.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        co_await prefetch(&v[lo + half]);
+        if (v[lo + half] < key) {
+            lo += half;
+        }
+        n -= half;
+    }
+    co_return lo + (v[lo] < key);
+}
+
+// ----- hash probe -----
+
+// Keys are nonzero; zero marks an empty slot.
+static bool plain_contains(const std::vector<uint64_t>& table, uint64_t key)
+{
+    size_t mask = table.size() - 1;
+    for (size_t i = hash64(key) & mask; ; i = (i + 1) & mask) {
+        if (table[i] == key) {
+            return true;
+        } else if (table[i] == 0) {
+            return false;
+        }
+    }
+}
+
+interleaved_task<bool> interleaved_contains(const std::vector<uint64_t>& table, uint64_t key)
+{
+    size_t mask = table.size() - 1;
+    size_t i = hash64(key) & mask;
+    co_await prefetch(&table[i]);
+    for (; ; i = (i + 1) & mask) {
+        if (table[i] == key) {
+            co_return true;
+        } else if (table[i] == 0) {
+            co_return false;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int log2Bytes = (argc > 1) ? atoi(argv[1]) : 30;
+    const size_t lookups = size_t(1) << 20;
+    const size_t widths[] = {1, 2, 4, 8, 16, 32};
+
+    std::vector<uint32_t> sorted(size_t(1) << (log2Bytes - 2));
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        sorted[i] = uint32_t(2 * i);
+    }
+    std::vector<uint64_t> table(size_t(1) << (log2Bytes - 3));
+    for (size_t k = 1; k <= table.size() / 2; ++k) {
+        size_t mask = table.size() - 1;
+        size_t i = hash64(k) & mask;
+        while (table[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        table[i] = k;
+    }
+
+    // Half of the keys hit, half miss.
+    std::mt19937_64 rng(42);
+    std::vector<uint32_t> searchKeys(lookups);
+    std::vector<uint64_t> probeKeys(lookups);
+    for (size_t i = 0; i < lookups; ++i) {
+        searchKeys[i] = uint32_t(rng() % (2 * sorted.size()));
+        probeKeys[i] = 1 + rng() % table.size();
+    }
+
+    printf("tables of %zu MiB each, %zu lookups\n", (size_t(1) << log2Bytes) >> 20, lookups);
+    printf("%-12s %16s %16s\n", "", "binary search", "hash probe");
+
+    size_t expectedSum = 0;
+    size_t expectedHits = 0;
+    auto start = bench_clock::now();
+    for (uint32_t key : searchKeys) {
+        expectedSum += plain_lower_bound(sorted, key);
+    }
+    double searchPlain = ns_per(start, lookups);
+    start = bench_clock::now();
+    for (uint64_t key : probeKeys) {
+        expectedHits += plain_contains(table, key);
+    }
+    double probePlain = ns_per(start, lookups);
+    printf("%-12s %14.1fns %14.1fns\n", "plain loop", searchPlain, probePlain);
+
+    for (size_t width : widths) {
+        interleave_group<> group(width);
+
+        size_t sum = 0;
+        start = bench_clock::now();
+        group.run(lookups,
+            [&](size_t i) { return interleaved_lower_bound(sorted, searchKeys[i]); },
+            [&](size_t, size_t r) { sum += r; }
+        );
+        double searchInterleaved = ns_per(start, lookups);
+
+        size_t hits = 0;
+        start = bench_clock::now();
+        group.run(lookups,
+            [&](size_t i) { return interleaved_contains(table, probeKeys[i]); },
+            [&](size_t, bool r) { hits += r; }
+        );
+        double probeInterleaved = ns_per(start, lookups);
+
+        if (sum != expectedSum || hits != expectedHits) {
+            printf("width %zu: wrong answer!\n", width);
+            return 1;
+        }
+        char label[32];
+        snprintf(label, sizeof label, "group of %zu", width);
+        printf("%-12s %14.1fns %14.1fns   (%.2fx, %.2fx)\n", label,
+            searchInterleaved, probeInterleaved,
+            searchPlain / searchInterleaved, probePlain / probeInterleaved);
+    }
+}
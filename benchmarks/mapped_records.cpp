@@ -0,0 +1,147 @@
+// Reading a large log file line by line, in GB/s, with the file already in
+// the page cache: std::getline into one reused std::string, a
+// unique_generator<std::string> that yields a fresh copy of each line (one
+// allocation and one copy per line), and mapped_records(), whose
+// std::string_views point straight into a mapping of the file, on one
+// thread and on shards of the file across all hardware threads.
+// Build and run with "make bench"; pass an argument to change the size of
+// the generated file, in MiB (default 1024).
+
+#include "coro/mapped_records.h"
+#include "coro/unique_generator.h"
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+struct totals {
+    size_t lines = 0;
+    size_t bytes = 0;
+
+    void add(std::string_view line) {
+        lines += 1;
+        bytes += line.size();
+    }
+};
+
+static void write_log(const char *path, size_t bytes)
+{
+    std::ofstream out(path, std::ios::binary);
+    std::mt19937 g(42);
+    std::string line;
+    for (size_t written = 0; written < bytes; written += line.size()) {
+        line.assign(20 + g() % 180, 'a' + g() % 26);
+        line.back() = '\n';
+        out << line;
+    }
+}
+
+unique_generator<std::string> copied_lines(const char *path)
+{
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line); ) {
+        co_yield line;
+    }
+}
+
+static totals by_getline(const char *path)
+{
+    totals t;
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line); ) {
+        t.add(line);
+    }
+    return t;
+}
+
+static totals by_copying_generator(const char *path)
+{
+    totals t;
+    for (std::string line : copied_lines(path)) {
+        t.add(line);
+    }
+    return t;
+}
+
+static totals by_mapped_records(const char *path)
+{
+    totals t;
+    for (std::string_view line : mapped_records(path)) {
+        t.add(line);
+    }
+    return t;
+}
+
+static totals by_shards(const char *path, size_t shards)
+{
+    mapped_file file(path);
+    std::vector<totals> parts(shards);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < shards; ++i) {
+        threads.emplace_back([&, i]() {
+            for (std::string_view line : mapped_records(file, '\n', i, shards)) {
+                parts[i].add(line);
+            }
+        });
+    }
+    totals t;
+    for (size_t i = 0; i < shards; ++i) {
+        threads[i].join();
+        t.lines += parts[i].lines;
+        t.bytes += parts[i].bytes;
+    }
+    return t;
+}
+
+template<class F>
+static totals report(const char *name, size_t fileBytes, F f)
+{
+    auto start = bench_clock::now();
+    totals t = f();
+    double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+    printf("%-28s %8.2f GB/s %12zu lines\n", name, fileBytes / seconds / 1e9, t.lines);
+    return t;
+}
+
+int main(int argc, char **argv)
+{
+    size_t mib = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1024;
+    size_t threads = std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    char path[] = "/tmp/mapped_records_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    write_log(path, mib << 20);
+    size_t fileBytes = mapped_file(path).size();
+    by_mapped_records(path);  // warm the page cache
+
+    printf("%zu MiB of lines of 20 to 200 bytes\n", mib);
+    totals expected = report("std::getline", fileBytes, [&]() { return by_getline(path); });
+    totals results[] = {
+        report("unique_generator<string>", fileBytes, [&]() { return by_copying_generator(path); }),
+        report("mapped_records", fileBytes, [&]() { return by_mapped_records(path); }),
+        report(("mapped_records, " + std::to_string(threads) + " shards").c_str(), fileBytes, [&]() { return by_shards(path, threads); }),
+    };
+    unlink(path);
+    for (const totals& t : results) {
+        if (t.lines != expected.lines || t.bytes != expected.bytes) {
+            printf("wrong totals!\n");
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,138 @@
+// Scaling of parallel_transform_reduce on work_stealing_pools of 1 to N
+// threads, against a serial std::transform_reduce: a numeric workload
+// (sum of square roots over 20M doubles), a string workload (hashing 2M
+// short strings), and the same strings coming out of a unique_generator,
+// which is pulled in batches by one producer.
+// Build and run with "make bench"; pass an argument to change the maximum
+// number of threads (default: the hardware concurrency).
+
+#include "coro/parallel_algorithms.h"
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include "coro/unique_generator.h"
+#include "coro/work_stealing_pool.h"
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ms_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+static auto root = [](double d) {
+    return std::sqrt(d);
+};
+
+static auto hash = [](const std::string& s) {
+    uint64_t h = 0xcbf29ce484222325;
+    for (int round = 0; round < 8; ++round) {
+        for (char c : s) {
+            h = (h ^ uint8_t(c)) * 0x100000001b3;
+        }
+    }
+    return h;
+};
+
+unique_generator<std::string> strings_of(const std::vector<std::string>& v)
+{
+    for (const std::string& s : v) {
+        co_yield s;
+    }
+}
+
+template<class T>
+static void row(const char *name, double serial, const std::vector<double>& times, T result, T expected)
+{
+    printf("%-12s %8.1fms", name, serial);
+    for (double t : times) {
+        printf(" %8.1fms (%4.1fx)", t, serial / t);
+    }
+    printf("\n");
+    if (result != expected) {
+        printf("wrong result!\n");
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t maxThreads = (argc > 1) ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+    std::vector<size_t> threadCounts;
+    for (size_t t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::vector<double> numbers(20'000'000);
+    std::iota(numbers.begin(), numbers.end(), 0.0);
+    std::vector<std::string> strings(2'000'000);
+    std::mt19937 g(42);
+    for (std::string& s : strings) {
+        s.assign(10 + g() % 90, char('a' + g() % 26));
+    }
+
+    printf("%-12s %10s", "", "serial");
+    for (size_t t : threadCounts) {
+        printf(" %10zu threads", t);
+    }
+    printf("\n");
+
+    // The serial sum adds up the same chunks in the same order, so that the
+    // results match bit for bit.
+    auto start = bench_clock::now();
+    double rootSum = 0;
+    for (size_t lo = 0; lo < numbers.size(); lo += 65536) {
+        double chunk = root(numbers[lo]);
+        for (size_t i = lo + 1; i < std::min(numbers.size(), lo + 65536); ++i) {
+            chunk += root(numbers[i]);
+        }
+        rootSum += chunk;
+    }
+    double serialRoots = ms_since(start);
+
+    start = bench_clock::now();
+    uint64_t hashSum = std::transform_reduce(strings.begin(), strings.end(), uint64_t(0), std::plus<>(), hash);
+    double serialStrings = ms_since(start);
+
+    std::vector<double> roots, hashes, generated;
+    double parallelRootSum = 0;
+    uint64_t parallelHashSum = 0, generatedHashSum = 0;
+    for (size_t t : threadCounts) {
+        work_stealing_pool pool(t);
+        auto ex = pool.get_executor();
+
+        start = bench_clock::now();
+        sync_wait([&]() -> task<void> {
+            parallelRootSum = co_await parallel_transform_reduce(ex, numbers, 65536, 0.0, std::plus<>(), root);
+        }());
+        roots.push_back(ms_since(start));
+
+        start = bench_clock::now();
+        sync_wait([&]() -> task<void> {
+            parallelHashSum = co_await parallel_transform_reduce(ex, strings, 4096, uint64_t(0), std::plus<>(), hash);
+        }());
+        hashes.push_back(ms_since(start));
+
+        start = bench_clock::now();
+        sync_wait([&]() -> task<void> {
+            generatedHashSum = co_await parallel_transform_reduce(ex, strings_of(strings), 4096, uint64_t(0), std::plus<>(), hash);
+        }());
+        generated.push_back(ms_since(start));
+    }
+    row("sqrt", serialRoots, roots, parallelRootSum, rootSum);
+    row("strings", serialStrings, hashes, parallelHashSum, hashSum);
+    row("generator", serialStrings, generated, generatedHashSum, hashSum);
+}
@@ -0,0 +1,168 @@
+// Reading a file from disk (evicted from the page cache before every run)
+// and checksumming it chunk by chunk: read-then-process with plain pread()
+// calls, versus read_ahead with 1 buffer (nothing to overlap with), 2
+// (double buffering) and 4. The reads run on a work_stealing_pool kept for
+// I/O; the processing loop resumes on whichever of its threads finished a
+// read, so the pool has a thread more than the most reads in flight.
+// Buffered reads are done first: there the kernel's own readahead of a
+// sequential file already overlaps the I/O with processing, and read_ahead
+// has little left to hide. With O_DIRECT the kernel reads nothing ahead,
+// and read_ahead is what keeps the disk busy. Besides the total time, we
+// report how long the processing loop sat waiting for data: the I/O that
+// wasn't overlapped with processing.
+// Build and run with "make bench"; pass an argument to change the size of
+// the file, in MiB (default 256).
+
+#include "coro/read_ahead.h"
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include "coro/work_stealing_pool.h"
+#include <chrono>
+#include <fcntl.h>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+static const size_t chunk_size = 1 << 20;
+
+static void evict(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// The "processing": FNV-1a over every 64-bit word, which costs about as
+// much as reading the data off a fast disk does.
+static uint64_t process(const std::byte *p, size_t n, uint64_t h)
+{
+    for (size_t i = 0; i + 8 <= n; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h = (h ^ word) * 0x100000001b3;
+    }
+    return h;
+}
+
+struct result {
+    uint64_t hash_ = 0;
+    bench_clock::duration waiting_{};
+};
+
+static result read_then_process(const char *path, int openFlags, bool doProcess)
+{
+    int fd = open(path, O_RDONLY | openFlags);
+    if (fd < 0) {
+        perror("open");
+        exit(1);
+    }
+    std::unique_ptr<std::byte[], read_ahead_detail::aligned_delete> buffer(
+        new (std::align_val_t(read_ahead_alignment)) std::byte[chunk_size]
+    );
+    result r;
+    off_t offset = 0;
+    while (true) {
+        auto asked = bench_clock::now();
+        ssize_t n = pread(fd, buffer.get(), chunk_size, offset);
+        r.waiting_ += bench_clock::now() - asked;
+        if (n < 0) {
+            perror("pread");
+            exit(1);
+        } else if (n == 0) {
+            break;
+        }
+        offset += n;
+        if (doProcess) {
+            r.hash_ = process(buffer.get(), n, r.hash_);
+        }
+    }
+    close(fd);
+    return r;
+}
+
+task<void> read_ahead_and_process(work_stealing_pool::executor ex, const char *path, int openFlags, size_t buffers, result& r)
+{
+    auto chunks = read_ahead(ex, path, chunk_size, buffers, openFlags);
+    auto asked = bench_clock::now();
+    for (auto it = co_await chunks.begin(); it != chunks.end(); co_await ++it) {
+        r.waiting_ += bench_clock::now() - asked;
+        std::span<const std::byte> chunk = *it;
+        r.hash_ = process(chunk.data(), chunk.size(), r.hash_);
+        asked = bench_clock::now();
+    }
+}
+
+static void report(const char *name, bench_clock::time_point start, const result& r, uint64_t expected)
+{
+    double total = std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+    double waiting = std::chrono::duration<double, std::milli>(r.waiting_).count();
+    printf("%-32s %8.0fms %8.0fms\n", name, total, waiting);
+    if (r.hash_ != expected) {
+        printf("wrong checksum!\n");
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t mib = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 256;
+
+    char path[] = "/tmp/read_ahead_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    auto buffer = std::make_unique<std::byte[]>(chunk_size);
+    for (size_t i = 0; i < chunk_size; ++i) {
+        buffer[i] = std::byte(i * 7);
+    }
+    for (size_t i = 0; i < mib; ++i) {
+        if (write(fd, buffer.get(), chunk_size) != ssize_t(chunk_size)) {
+            perror("write");
+            return 1;
+        }
+    }
+    fsync(fd);
+    close(fd);
+
+    printf("%zu MiB in %zu KiB chunks, evicted from the page cache before each run\n", mib, chunk_size >> 10);
+    printf("%-32s %10s %10s\n", "", "total", "waiting");
+
+    read_then_process(path, 0, false);  // into the page cache
+    auto start = bench_clock::now();
+    uint64_t expected = read_then_process(path, 0, true).hash_;
+    report("process only (cached)", start, result{expected}, expected);
+
+    work_stealing_pool io(5);
+    for (int openFlags : {0, O_DIRECT}) {
+        const char *mode = (openFlags == 0) ? "buffered" : "O_DIRECT";
+        char name[64];
+
+        evict(path);
+        start = bench_clock::now();
+        snprintf(name, sizeof name, "%s: read only", mode);
+        report(name, start, read_then_process(path, openFlags, false), 0);
+
+        evict(path);
+        start = bench_clock::now();
+        snprintf(name, sizeof name, "%s: read, then process", mode);
+        report(name, start, read_then_process(path, openFlags, true), expected);
+
+        for (size_t buffers : {1, 2, 4}) {
+            evict(path);
+            result r;
+            start = bench_clock::now();
+            sync_wait(read_ahead_and_process(io.get_executor(), path, openFlags, buffers, r));
+            snprintf(name, sizeof name, "%s: read_ahead, %zu buffer%s", mode, buffers, buffers == 1 ? "" : "s");
+            report(name, start, r, expected);
+        }
+    }
+    unlink(path);
+}
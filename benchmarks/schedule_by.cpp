@@ -0,0 +1,87 @@
+// Interactive requests mixed with a backlog of batch jobs on one
+// work_stealing_pool: the latency of each request (from submission to
+// completion) when it's scheduled with schedule(), behind the batch jobs,
+// versus with schedule_by(deadline), in the pool's deadline lane.
+// Build and run with "make bench"; pass an argument to change the number
+// of worker threads (default: the hardware concurrency).
+
+#include "coro/async_scope.h"
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include "coro/work_stealing_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static void spin_for(std::chrono::microseconds d)
+{
+    auto until = bench_clock::now() + d;
+    while (bench_clock::now() < until) {
+    }
+}
+
+task<void> batch_job(work_stealing_pool::executor ex)
+{
+    co_await ex.schedule();
+    spin_for(std::chrono::microseconds(50));
+}
+
+task<void> request(work_stealing_pool::executor ex, bool lane, bench_clock::duration& latency)
+{
+    auto submitted = bench_clock::now();
+    if (lane) {
+        co_await ex.schedule_by(submitted + std::chrono::milliseconds(1));
+    } else {
+        co_await ex.schedule();
+    }
+    spin_for(std::chrono::microseconds(5));
+    latency = bench_clock::now() - submitted;
+}
+
+static double us(bench_clock::duration d)
+{
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+static void run(size_t threads, bool lane)
+{
+    const size_t batchJobs = 4000 * threads;
+    const size_t requests = 500;
+    std::vector<bench_clock::duration> latency(requests);
+
+    work_stealing_pool pool(threads);
+    auto ex = pool.get_executor();
+    async_scope scope;
+    auto start = bench_clock::now();
+    for (size_t i = 0; i < batchJobs; ++i) {
+        scope.spawn(batch_job(ex));
+    }
+    for (size_t i = 0; i < requests; ++i) {
+        scope.spawn(request(ex, lane, latency[i]));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    sync_wait(scope.join());
+    double batchSeconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+    std::sort(latency.begin(), latency.end());
+    printf("%-16s %10.0fus %10.0fus %10.0fus %12.0f\n", lane ? "schedule_by" : "schedule",
+        us(latency[requests / 2]), us(latency[requests * 99 / 100]), us(latency.back()),
+        batchJobs / batchSeconds);
+}
+
+int main(int argc, char **argv)
+{
+    size_t threads = (argc > 1) ? atoi(argv[1]) : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+    printf("%zu threads; %zu batch jobs of 50us, then 500 requests of 5us, one every 200us\n", threads, 4000 * threads);
+    printf("%-16s %12s %12s %12s %12s\n", "requests use", "p50", "p99", "max", "batch jobs/s");
+    run(threads, false);
+    run(threads, true);
+}
@@ -0,0 +1,83 @@
+// A 10-deep chain of task<int>s whose leaf fails half the time: failing by
+// throwing an exception, which every level catches and rethrows through its
+// promise, versus failing with co_return error(e) in task<int, E>, which
+// skips straight past every awaiting level.
+// Build and run with "make bench"; pass an argument to change the number of chains.
+
+#include "coro/sync_wait.h"
+#include "coro/task.h"
+#include <chrono>
+#include <stdexcept>
+#include <stdio.h>
+#include <stdlib.h>
+
+using bench_clock = std::chrono::steady_clock;
+
+enum class failure { odd_input };
+
+task<int> throwing_chain(int depth, int x)
+{
+    if (depth == 0) {
+        if (x & 1) {
+            throw std::runtime_error("odd input");
+        }
+        co_return x;
+    }
+    co_return 1 + co_await throwing_chain(depth - 1, x);
+}
+
+task<int, failure> error_chain(int depth, int x)
+{
+    if (depth == 0) {
+        if (x & 1) {
+            co_return error(failure::odd_input);
+        }
+        co_return x;
+    }
+    co_return 1 + co_await error_chain(depth - 1, x);
+}
+
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : 200000;
+    const int depth = 10;
+
+    long sum = 0;
+    long failures = 0;
+    auto start = bench_clock::now();
+    sync_wait([&]() -> task<void> {
+        for (int i = 0; i < count; ++i) {
+            try {
+                sum += co_await throwing_chain(depth, i);
+            } catch (const std::runtime_error&) {
+                failures += 1;
+            }
+        }
+    }());
+    double throwingNs = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / count;
+
+    long errorSum = 0;
+    long errorFailures = 0;
+    start = bench_clock::now();
+    sync_wait([&]() -> task<void> {
+        for (int i = 0; i < count; ++i) {
+            auto t = error_chain(depth, i);
+            co_await t.when_ready();
+            if (t.failed()) {
+                errorFailures += 1;
+            } else {
+                errorSum += t.get();
+            }
+        }
+    }());
+    double errorNs = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count() / count;
+
+    if (sum != errorSum || failures != errorFailures) {
+        printf("results differ!\n");
+        return 1;
+    }
+    printf("%d-deep chains, %ld of %d failing\n", depth, failures, count);
+    printf("%-24s %10.1fns per chain\n", "exception", throwingNs);
+    printf("%-24s %10.1fns per chain\n", "co_return error(e)", errorNs);
+    printf("speedup: %.1fx\n", throwingNs / errorNs);
+}
@@ -0,0 +1,75 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/any_executor.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/concepts.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/new_thread_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/schedule_on.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/timer_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static_assert(Executor<any_executor>);
+
+// Not a template: one copy of this code serves every kind of executor.
+task<std::thread::id> where_does_it_run(any_executor ex)
+{
+    co_await ex.schedule();
+    assert(ex.running_in_this_thread());
+    co_return std::this_thread::get_id();
+}
+
+task<void> hop_around(std::vector<any_executor> executors)
+{
+    for (any_executor& ex : executors) {
+        std::thread::id id = co_await where_does_it_run(ex);
+        assert(id != std::this_thread::get_id() || ex.running_in_this_thread());
+    }
+}
+
+task<void> at_home(any_executor home, any_executor elsewhere)
+{
+    co_await home_on(home);
+    for (int i=0; i < 5; ++i) {
+        std::thread::id id = co_await where_does_it_run(elsewhere);
+        assert(id != std::this_thread::get_id());
+        assert(home.running_in_this_thread());
+    }
+}
+
+task<void> come_back(any_executor back, any_executor away)
+{
+    co_await resume_on(back, where_does_it_run(away));
+    assert(back.running_in_this_thread());
+}
+
+int main()
+{
+    work_stealing_pool pool(2);
+    new_thread_context threads;
+    timer_context timers;
+
+    any_executor none;
+    assert(!none);
+
+    std::vector<any_executor> executors = {
+        pool.get_executor(),
+        threads.get_executor(),
+        timers.get_executor(),
+    };
+    for (any_executor& ex : executors) {
+        assert(ex);
+        assert(!ex.running_in_this_thread());
+    }
+    sync_wait(hop_around(executors));
+
+    // any_executor works wherever an Executor does.
+    sync_wait(at_home(pool.get_executor(), threads.get_executor()));
+    sync_wait(come_back(timers.get_executor(), pool.get_executor()));
+
+    std::cout << "Success!\n";
+}
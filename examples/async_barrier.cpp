@@ -0,0 +1,74 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_barrier.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_latch.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_manual_reset_event.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Four workers wait for a start signal, then run three phases in lockstep.
+// Each phase's completion function checks that every worker did its part
+// before anyone moves on. When all the workers are finished, a latch
+// lets main() know.
+
+constexpr int workers = 4;
+constexpr int phases = 3;
+
+std::atomic<int> work_done{0};
+int phases_completed = 0;
+
+struct on_phase_complete {
+    void operator()() noexcept {
+        phases_completed += 1;
+        assert(work_done == workers * phases_completed);
+        std::cout << "phase " << phases_completed << " complete\n";
+    }
+};
+
+task<void> worker(async_manual_reset_event& start, async_barrier<on_phase_complete>& barrier, async_latch& finished)
+{
+    co_await start;
+    for (int i=0; i < phases; ++i) {
+        work_done += 1;
+        co_await barrier.arrive_and_wait();
+    }
+    finished.count_down();
+}
+
+task<void> wait_for(async_latch& latch)
+{
+    co_await latch;
+}
+
+int main()
+{
+    async_manual_reset_event start;
+    async_barrier<on_phase_complete> barrier(workers);
+    async_latch finished(workers);
+
+    std::vector<std::thread> threads;
+    for (int i=0; i < workers; ++i) {
+        threads.emplace_back([&]() {
+            sync_wait(worker(start, barrier, finished));
+        });
+    }
+    assert(!finished.try_wait());
+    start.set();
+    sync_wait(wait_for(finished));
+    assert(finished.try_wait());
+    assert(phases_completed == phases);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // A manual-reset event stays set until it is reset.
+    assert(start.is_set());
+    start.reset();
+    assert(!start.is_set());
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,91 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_scope.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/concepts.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/new_thread_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <stdlib.h>
+
+// An allocator that can be told to fail.
+static thread_local bool fail_next_allocation = false;
+
+void *operator new(size_t n)
+{
+    if (fail_next_allocation) {
+        fail_next_allocation = false;
+        throw std::bad_alloc();
+    }
+    if (void *p = malloc(n ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+std::atomic<int> jobs_done{0};
+
+task<void> background_job(int i)
+{
+    if (i == 13) {
+        throw std::runtime_error("job 13 is unlucky");
+    }
+    jobs_done += 1;
+    co_return;
+}
+
+template<Executor E>
+task<void> launch_and_join(E e, int n)
+{
+    async_scope scope;
+    for (int i=0; i < n; ++i) {
+        scope.spawn(e, background_job(i));
+    }
+    try {
+        co_await scope.join();
+        assert(false);
+    } catch (const std::runtime_error& ex) {
+        std::cout << "join rethrew: " << ex.what() << "\n";
+    }
+}
+
+// A spawn that throws leaves nothing for join() to wait on.
+template<Executor E>
+task<void> spawn_fails(E e)
+{
+    async_scope scope;
+    scope.spawn(e, background_job(0));
+    for (bool onExecutor : {true, false}) {
+        task<void> t = background_job(1);
+        fail_next_allocation = true;
+        try {
+            if (onExecutor) {
+                scope.spawn(e, std::move(t));
+            } else {
+                scope.spawn(std::move(t));
+            }
+            assert(false);
+        } catch (const std::bad_alloc&) {
+        }
+    }
+    co_await scope.join();
+}
+
+int main()
+{
+    new_thread_context ctx;
+    sync_wait(launch_and_join(ctx.get_executor(), 100));
+    assert(jobs_done == 99);
+
+    jobs_done = 0;
+    sync_wait(spawn_fails(ctx.get_executor()));
+    assert(jobs_done == 1);
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,98 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_semaphore.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/timer_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/token_bucket.h>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+std::atomic<int> in_flight{0};
+std::atomic<int> max_in_flight{0};
+
+task<void> limited_job(async_semaphore& sem, int id)
+{
+    co_await sem.acquire();
+    int n = ++in_flight;
+    int m = max_in_flight.load();
+    while (n > m && !max_in_flight.compare_exchange_weak(m, n)) {}
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    --in_flight;
+    sem.release();
+    std::cout << "job " << id << " done\n";
+}
+
+void test_semaphore()
+{
+    // Eight callers, but never more than three of them at once.
+    async_semaphore sem(3);
+    std::vector<std::thread> threads;
+    for (int i=0; i < 8; ++i) {
+        threads.emplace_back([&sem, i]() {
+            sync_wait(limited_job(sem, i));
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    assert(max_in_flight <= 3);
+    assert(sem.available() == 3);
+}
+
+task<void> rate_limited_requests(token_bucket& bucket, int n)
+{
+    for (int i=0; i < n; ++i) {
+        co_await bucket.acquire();
+        std::cout << "request " << i << " on thread " << std::this_thread::get_id() << "\n";
+    }
+}
+
+void test_token_bucket()
+{
+    // Twenty tokens per second, and a burst of two: the first two requests
+    // go through immediately, the rest at intervals of 50ms.
+    timer_context timers;
+    token_bucket bucket(timers, 20.0, 2.0);
+    auto start = std::chrono::steady_clock::now();
+    sync_wait(rate_limited_requests(bucket, 6));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    assert(elapsed >= std::chrono::milliseconds(190));
+
+    // More than burst tokens at once could never be had.
+    try {
+        (void)bucket.acquire(3);
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+    try {
+        bucket.try_acquire(3);
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+
+    for (double rate : {0.0, -1.0}) {
+        try {
+            token_bucket bad(timers, rate, 2.0);
+            assert(false);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    try {
+        token_bucket bad(timers, 20.0, 0.0);
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+int main()
+{
+    test_semaphore();
+    test_token_bucket();
+    std::cout << "Success!\n";
+}
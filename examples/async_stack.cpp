@@ -0,0 +1,92 @@
+// https://coro.godbolt.org/z/
+
+#define CORO_ASYNC_STACK 1
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_semaphore.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_stack.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Each line of a dump is a return address inside a suspended task;
+// build with -g and pass the +0x offsets to addr2line -Cfpe to see where.
+
+async_semaphore gate(0);
+
+task<int> fetch_row(int id)
+{
+    co_await gate.acquire();  // stuck here until main() releases the gate
+    co_return id * 10;
+}
+
+task<int> run_query(int id)
+{
+    int row = co_await fetch_row(id);
+    co_return row + 1;
+}
+
+task<void> handle_request(int id)
+{
+    int result = co_await run_query(id);
+    assert(result == id * 10 + 1);
+}
+
+int count_lines(const std::string& s, const std::string& prefix)
+{
+    int n = 0;
+    std::istringstream is(s);
+    for (std::string line; std::getline(is, line); ) {
+        n += (line.compare(0, prefix.size(), prefix) == 0);
+    }
+    return n;
+}
+
+int main()
+{
+    std::thread t1([]() { sync_wait(handle_request(1)); });
+    std::thread t2([]() { sync_wait(run_query(2)); });
+
+    // Both threads get stuck, three and two tasks deep respectively.
+    std::string dump;
+    for (int tries = 0; count_lines(dump, "  #") != 5; ++tries) {
+        assert(tries < 1000);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::ostringstream os;
+        dump_async_roots(os);
+        dump = os.str();
+    }
+    std::cout << dump;
+    assert(count_lines(dump, "async stack") == 2);
+
+    gate.release(2);
+    t1.join();
+    t2.join();
+
+    // Finished tasks leave no trace.
+    std::ostringstream os;
+    dump_async_roots(os);
+    assert(os.str().empty());
+
+    // Dumping while chains of tasks come and go on another thread is safe:
+    // a finishing task waits for the dump walking it.
+    std::atomic<bool> done{false};
+    std::thread churn([&]() {
+        for (int i = 0; i < 20000; ++i) {
+            gate.release();
+            sync_wait(handle_request(i));
+        }
+        done = true;
+    });
+    while (!done) {
+        std::ostringstream ignored;
+        dump_async_roots(ignored);
+    }
+    churn.join();
+    std::cout << "Success!\n";
+}
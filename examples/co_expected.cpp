@@ -0,0 +1,77 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/co_expected.h>
+#include <assert.h>
+#include <memory>
+#include <string>
+#include <utility>
+
+enum class parse_error { empty, bad_digit, no_comma };
+
+auto parseInt(const std::string& input)
+    -> co_expected<int, parse_error>
+{
+    if (input.empty()) {
+        return unexpected(parse_error::empty);
+    }
+    int result = 0;
+    for (char c : input) {
+        if (c < '0' || c > '9') {
+            return unexpected(parse_error::bad_digit);
+        }
+        result = 10 * result + (c - '0');
+    }
+    return result;
+}
+
+auto splitString(const std::string& input)
+    -> co_expected<std::pair<std::string, std::string>, parse_error>
+{
+    auto k = input.find(',');
+    if (k == input.npos) {
+        return unexpected(parse_error::no_comma);
+    }
+    return std::make_pair(input.substr(0, k), input.substr(k+1));
+}
+
+co_expected<int, parse_error> split_and_add(const std::string& input)
+{
+    auto [a, b] = co_await splitString(input);
+    co_return co_await parseInt(a) + co_await parseInt(b);
+}
+
+// Errors convert to the enclosing coroutine's error type.
+co_expected<std::string, std::string> describe(const std::string& input)
+{
+    co_expected<int, parse_error> sum = split_and_add(input);
+    if (!sum) {
+        co_return unexpected(std::string("parse error ") + std::to_string(int(sum.error())));
+    }
+    co_return "sum is " + std::to_string(*sum);
+}
+
+// Awaiting an lvalue refers to its value; awaiting an rvalue moves it.
+co_expected<std::unique_ptr<int>, parse_error> boxed(int x)
+{
+    co_return std::make_unique<int>(x);
+}
+
+co_expected<int, parse_error> unbox_both()
+{
+    auto a = boxed(1);
+    std::unique_ptr<int>& pa = co_await a;
+    std::unique_ptr<int> pb = co_await boxed(2);
+    co_return *pa + *pb;
+}
+
+int main()
+{
+    assert(split_and_add("1,2") == 3);
+    assert(split_and_add("1,x").error() == parse_error::bad_digit);
+    assert(split_and_add("x,2").error() == parse_error::bad_digit);
+    assert(split_and_add(",2").error() == parse_error::empty);
+    assert(split_and_add("12").error() == parse_error::no_comma);
+    assert(*describe("40,2") == "sum is 42");
+    assert(describe("40").error() == "parse error 2");
+    assert(unbox_both().value() == 3);
+}
@@ -0,0 +1,102 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/co_future.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+co_future<int> add_one(co_future<int> f)
+{
+    int x = co_await f;
+    std::cout << "add_one resumed on thread " << std::this_thread::get_id() << "\n";
+    co_return x + 1;
+}
+
+struct throws_on_construction {
+    explicit throws_on_construction(int) { throw std::runtime_error("no"); }
+};
+
+co_future<void> fail()
+{
+    throw std::runtime_error("oops");
+    co_return;
+}
+
+int main()
+{
+    std::cout << "main is thread " << std::this_thread::get_id() << "\n";
+
+    // add_one suspends on the future, and the producer thread resumes it.
+    co_promise<int> p;
+    co_future<int> f = add_one(p.get_future());
+    std::thread producer([&]() { p.set_value(41); });
+    assert(f.get() == 42);
+    producer.join();
+
+    // Exceptions propagate through the shared state.
+    try {
+        fail().get();
+        assert(false);
+    } catch (const std::runtime_error& e) {
+        std::cout << "caught " << e.what() << "\n";
+    }
+
+    // So does a promise destroyed without a value.
+    co_future<int> orphan;
+    if (true) {
+        co_promise<int> q;
+        orphan = q.get_future();
+    }
+    try {
+        orphan.get();
+        assert(false);
+    } catch (const std::future_error& e) {
+        assert(e.code() == std::future_errc::broken_promise);
+    }
+
+    // Even if it tried to set a value whose constructor threw.
+    co_future<throws_on_construction> unmade;
+    if (true) {
+        co_promise<throws_on_construction> q;
+        unmade = q.get_future();
+        try {
+            q.set_value(1);
+            assert(false);
+        } catch (const std::runtime_error&) {
+        }
+    }
+    try {
+        unmade.get();
+        assert(false);
+    } catch (const std::future_error& e) {
+        assert(e.code() == std::future_errc::broken_promise);
+    }
+
+    // A chain of continuations: two on the pool, the rest inline on
+    // whichever thread finished the previous link.
+    work_stealing_pool pool(2);
+    std::set<std::thread::id> threads;
+    co_promise<int> start;
+    co_future<int> chain = start.get_future()
+        .then(pool.get_executor(), [&](co_future<int> f) { threads.insert(std::this_thread::get_id()); return f.get() * 2; })
+        .then([&](co_future<int> f) { threads.insert(std::this_thread::get_id()); return f.get() + 1; })
+        .then(pool.get_executor(), [&](co_future<int> f) { threads.insert(std::this_thread::get_id()); return f.get() * 10; })
+        .then([&](co_future<int> f) { return f.get() - 1; });
+    start.set_value(4);
+    assert(chain.get() == (4 * 2 + 1) * 10 - 1);
+    assert(threads.size() <= 2);
+    assert(threads.count(std::this_thread::get_id()) == 0);
+
+    // A continuation that takes no argument just runs once the future is ready.
+    co_promise<int> go;
+    bool ran = false;
+    co_future<int> seven = go.get_future().then([&]() { ran = true; return 7; });
+    assert(!ran);
+    go.set_value(1);
+    assert(ran);
+    assert(seven.get() == 7);
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,79 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_scope.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/executor_metrics.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/new_thread_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+std::atomic<int> jobs_done{0};
+
+template<class E>
+task<void> job(E ex, int hops)
+{
+    for (int i=0; i < hops; ++i) {
+        co_await ex.schedule();
+    }
+    jobs_done += 1;
+}
+
+template<class E>
+task<void> run_jobs(E ex, int n, int hops)
+{
+    async_scope scope;
+    for (int i=0; i < n; ++i) {
+        scope.spawn(ex, job(ex, hops));
+    }
+    co_await scope.join();
+}
+
+void test_pool()
+{
+    work_stealing_pool pool(4);
+    // Give the workers time to find there's nothing to do yet.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    sync_wait(run_jobs(pool.get_executor(), 1000, 10));
+    assert(jobs_done == 1000);
+
+    executor_metrics m = pool.metrics();
+    // Each job is spawned onto the pool with a schedule(), then hops ten times.
+    assert(m.scheduled_ == 1000 * 11);
+    assert(m.resumed_ == 1000 * 11);
+    assert(m.latency_.count_ == 1000 * 11);
+    assert(m.queueDepth_ == 0);
+    assert(m.parks_ >= 1 && m.parkedNs_ > 0);
+    assert(m.liveThreads_ == 4);
+    std::cout << "pool: " << m.steals_ << " steals, " << m.wakeups_ << " wakeups, "
+              << "median latency <= " << m.latency_.quantile_ns(0.5) << "ns, "
+              << "p99 <= " << m.latency_.quantile_ns(0.99) << "ns\n";
+    m.write_text(std::cout, "coro_pool");
+}
+
+void test_new_thread_context()
+{
+    jobs_done = 0;
+    new_thread_context ctx;
+    sync_wait(run_jobs(ctx.get_executor(), 10, 1));
+    assert(jobs_done == 10);
+
+    executor_metrics m = ctx.metrics();
+    assert(m.scheduled_ == 10 * 2);
+    assert(m.threadsStarted_ == 10 * 2);
+    assert(m.spawnFailures_ == 0);
+    assert(m.latency_.count_ <= 10 * 2);
+    std::cout << "new_thread_context: " << m.liveThreads_ << " live threads, "
+              << "mean start latency " << m.latency_.sumNs_ / (m.latency_.count_ ? m.latency_.count_ : 1) << "ns\n";
+}
+
+int main()
+{
+    test_pool();
+    test_new_thread_context();
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,86 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/fork_join.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <iostream>
+#include <memory>
+
+fork_task<long> fib(int n)
+{
+    if (n < 2) {
+        co_return n;
+    }
+    long a, b;
+    co_await fork_join::spawn(fib(n - 1), a);
+    co_await fork_join::spawn(fib(n - 2), b);
+    co_await fork_join::sync();
+    co_return a + b;
+}
+
+struct Tree {
+    std::unique_ptr<Tree> left;
+    std::unique_ptr<Tree> right;
+    int value;
+};
+
+std::unique_ptr<Tree> make_tree(int depth, int& next)
+{
+    if (depth == 0) {
+        return nullptr;
+    }
+    auto t = std::make_unique<Tree>();
+    t->left = make_tree(depth - 1, next);
+    t->value = next++;
+    t->right = make_tree(depth - 1, next);
+    return t;
+}
+
+fork_task<long> tree_sum(const Tree *t)
+{
+    if (t == nullptr) {
+        co_return 0;
+    }
+    long l, r;
+    co_await fork_join::spawn(tree_sum(t->left.get()), l);
+    co_await fork_join::spawn(tree_sum(t->right.get()), r);
+    co_await fork_join::sync();
+    co_return l + t->value + r;
+}
+
+fork_task<void> count_leaves(const Tree *t, std::atomic<int>& leaves)
+{
+    if (t->left == nullptr) {
+        leaves += 1;
+        co_return;
+    }
+    co_await fork_join::spawn(count_leaves(t->left.get(), leaves));
+    co_await fork_join::spawn(count_leaves(t->right.get(), leaves));
+    co_await fork_join::sync();
+}
+
+task<void> run_all(work_stealing_pool& pool, const Tree *tree)
+{
+    long f = co_await fork_join::run(pool, fib(20));
+    std::cout << "fib(20) = " << f << "\n";
+    assert(f == 6765);
+
+    long sum = co_await fork_join::run(pool, tree_sum(tree));
+    std::cout << "tree sum = " << sum << "\n";
+    assert(sum == (1L << 12) * ((1L << 12) - 1) / 2);
+
+    std::atomic<int> leaves{0};
+    co_await fork_join::run(pool, count_leaves(tree, leaves));
+    assert(leaves == (1 << 11));
+}
+
+int main()
+{
+    int next = 1;
+    auto tree = make_tree(12, next);  // 4095 nodes, valued 1 to 4095
+    work_stealing_pool pool(4);
+    sync_wait(run_all(pool, tree.get()));
+    std::cout << "Success!\n";
+}
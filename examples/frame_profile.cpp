@@ -0,0 +1,81 @@
+// https://coro.godbolt.org/z/
+
+#define CORO_FRAME_PROFILE 1
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/frame_profile.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/shared_generator.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/unique_generator.h>
+#include <assert.h>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+unique_generator<int> iota(int n)
+{
+    for (int i=0; i < n; ++i) {
+        co_yield i;
+    }
+}
+
+task<int> sum(int n)
+{
+    int total = 0;
+    for (int x : iota(n)) {
+        total += x;
+    }
+    co_return total;
+}
+
+task<int> sum_of_sums(int n)
+{
+    int total = 0;
+    for (int i=0; i < n; ++i) {
+        total += co_await sum(i);
+    }
+    co_return total;
+}
+
+// A generator whose frame owns the node that owns the generator:
+// neither will ever be destroyed, unless someone breaks the cycle.
+struct node {
+    shared_generator<int> gen;
+};
+
+// Never used in the body; the parameter's copy in the frame is the point.
+shared_generator<int> forever([[maybe_unused]] std::shared_ptr<node> self)
+{
+    for (int i=0; true; ++i) {
+        co_yield i;
+    }
+}
+
+int main()
+{
+    int result = 0;
+    sync_wait([&]() -> task<void> {
+        result = co_await sum_of_sums(10);
+    }());
+    assert(result == 120);
+    assert(frame_profile_live_frames() == 0);
+
+    auto n = std::make_shared<node>();
+    n->gen = forever(n);
+    n = nullptr;
+    assert(frame_profile_live_frames() == 1);
+
+    // The report shows the leaked frame, and the stack that created it.
+    std::ostringstream os;
+    frame_profile_report(os);
+    std::cout << os.str();
+    std::string report = os.str();
+    assert(report.find("task_promise<int, void>: 11 allocated, 0 live") != std::string::npos);
+    assert(report.find("unique_generator<int, int>::promise_type: 10 allocated") != std::string::npos);
+    assert(report.find("live frame") != std::string::npos);
+    assert(report.find("shared_generator<int, int>::promise_type, created at") != std::string::npos);
+
+    // Since the leak is still there at exit, the same report goes to stderr.
+    std::cout << "Success!\n";
+}
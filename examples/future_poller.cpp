@@ -0,0 +1,106 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_scope.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/co_future.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/future_poller.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+std::atomic<long> total{0};
+std::atomic<int> failures{0};
+
+template<Executor E>
+co_future<void> consume(future_poller& poller, std::future<int> f, E ex)
+{
+    try {
+        int x = co_await poller.adopt(std::move(f), ex);
+        assert(ex.running_in_this_thread());
+        total += x;
+    } catch (const std::runtime_error&) {
+        failures += 1;
+    }
+}
+
+int main()
+{
+    const int n = 10000;
+    work_stealing_pool pool(2);
+    future_poller poller;
+
+    // Ten thousand legacy futures, fulfilled by one producer thread.
+    std::vector<std::promise<int>> promises(n);
+    async_scope scope;
+    for (int i=0; i < n; ++i) {
+        scope.spawn(consume(poller, promises[i].get_future(), pool.get_executor()));
+    }
+    std::thread producer([&]() {
+        for (int i=0; i < n; ++i) {
+            if (i % 1000 == 999) {
+                promises[i].set_exception(std::make_exception_ptr(std::runtime_error("no")));
+            } else {
+                promises[i].set_value(i);
+            }
+        }
+    });
+    sync_wait([&]() -> task<void> { co_await scope.join(); }());
+    producer.join();
+
+    long expected = 0;
+    for (int i=0; i < n; ++i) {
+        expected += (i % 1000 == 999) ? 0 : i;
+    }
+    assert(total == expected);
+    assert(failures == n / 1000);
+
+    // when_ready resumes on the poller thread, and leaves the future to us.
+    std::promise<int> p;
+    std::future<int> f = p.get_future();
+    std::thread late([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        p.set_value(42);
+    });
+    sync_wait([&]() -> task<void> {
+        co_await poller.when_ready(f);
+        assert(f.get() == 42);
+    }());
+    late.join();
+
+    // A deferred future runs when we get() it, on our own thread.
+    std::future<int> lazy = std::async(std::launch::deferred, []() { return 7; });
+    std::thread::id ran;
+    sync_wait([&]() -> task<void> {
+        co_await poller.when_ready(lazy);
+        int x = co_await poller.adopt(std::async(std::launch::deferred, [&]() {
+            ran = std::this_thread::get_id();
+            return 8;
+        }));
+        assert(lazy.get() + x == 15);
+    }());
+    assert(ran == std::this_thread::get_id());
+
+    // A future with no shared state is an error, not something to poll.
+    std::future<int> empty;
+    sync_wait([&]() -> task<void> {
+        try {
+            co_await poller.when_ready(empty);
+            assert(false);
+        } catch (const std::future_error& e) {
+            assert(e.code() == std::future_errc::no_state);
+        }
+        try {
+            co_await poller.adopt(std::future<int>());
+            assert(false);
+        } catch (const std::future_error& e) {
+            assert(e.code() == std::future_errc::no_state);
+        }
+    }());
+    std::cout << "Success!\n";
+}
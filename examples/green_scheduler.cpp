@@ -0,0 +1,138 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/green_scheduler.h>
+#include <assert.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// McNellis's named_counter, but taking turns under a scheduler
+// instead of being resumed by hand.
+green_thread named_counter(std::string& out, std::string name, int n)
+{
+    for (int i=1; i <= n; ++i) {
+        out += name + std::to_string(i) + " ";
+        co_await yield_now();
+    }
+}
+
+green_thread busy(long& total, int rounds)
+{
+    for (int i=0; i < rounds; ++i) {
+        total += 1;
+        co_await yield_now();
+    }
+}
+
+struct tracked {
+    int *alive_;
+    explicit tracked(int *alive) : alive_(alive) { ++*alive_; }
+    ~tracked() { --*alive_; }
+};
+
+green_thread sleeper(int *alive)
+{
+    tracked t(alive);
+    for (;;) {
+        co_await yield_now();
+    }
+}
+
+// Parks the green thread outside the run queue, for someone else to resume.
+struct park {
+    std::coroutine_handle<> *slot_;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const noexcept { *slot_ = h; }
+    void await_resume() const noexcept {}
+};
+
+green_thread parked(int *alive, std::coroutine_handle<> *slot)
+{
+    tracked t(alive);
+    co_await park{slot};
+}
+
+green_thread thrower(int rounds)
+{
+    for (int i=0; i < rounds; ++i) {
+        co_await yield_now();
+    }
+    throw std::runtime_error("oops");
+}
+
+int main()
+{
+    if (true) {
+        std::string out;
+        green_scheduler sched;
+        sched.spawn(named_counter(out, "a", 3));
+        sched.spawn(named_counter(out, "b", 2));
+        assert(out.empty());  // green threads start lazily
+        sched.run();
+        std::cout << out << "\n";
+        assert(out == "a1 b1 a2 b2 a3 ");
+        assert(sched.empty());
+    }
+
+    if (true) {
+        // A million green threads, a few switches each.
+        long total = 0;
+        green_scheduler sched;
+        for (int i=0; i < 1'000'000; ++i) {
+            sched.spawn(busy(total, 3));
+        }
+        sched.run();
+        assert(total == 3'000'000);
+    }
+
+    if (true) {
+        // The first exception stops run(); the rest stay queued,
+        // and the scheduler destroys them.
+        int alive = 0;
+        if (true) {
+            green_scheduler sched;
+            sched.spawn(sleeper(&alive));
+            sched.spawn(thrower(2));
+            sched.spawn(sleeper(&alive));
+            try {
+                sched.run();
+                assert(false);
+            } catch (const std::runtime_error& ex) {
+                assert(std::string(ex.what()) == "oops");
+            }
+            assert(alive == 2);
+            assert(!sched.empty());
+        }
+        assert(alive == 0);
+    }
+
+    if (true) {
+        // Green threads parked outside the queue are destroyed too.
+        int alive = 0;
+        std::coroutine_handle<> slot = nullptr;
+        if (true) {
+            green_scheduler sched;
+            sched.spawn(parked(&alive, &slot));
+            sched.spawn(sleeper(&alive));
+            sched.spawn(thrower(1));
+            try {
+                sched.run();
+                assert(false);
+            } catch (const std::runtime_error&) {
+            }
+            assert(alive == 2 && slot != nullptr);
+        }
+        assert(alive == 0);
+    }
+
+    if (true) {
+        // A green thread that's never spawned never runs.
+        int alive = 0;
+        if (true) {
+            green_thread t = sleeper(&alive);
+            assert(alive == 0);
+        }
+        assert(alive == 0);
+    }
+    std::cout << "Success!\n";
+}
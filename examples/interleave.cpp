@@ -0,0 +1,123 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/interleave.h>
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+// A binary search that prefetches each probe and lets the group
+// run the other searches while the cache line is on its way.
+interleaved_task<int> lower_bound_index(const std::vector<int>& v, int key)
+{
+    size_t lo = 0;
+    size_t n = v.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        co_await prefetch(&v[lo + half]);
+        if (v[lo + half] < key) {
+            lo += half;
+        }
+        n -= half;
+    }
+    co_return int(lo + (v[lo] < key));
+}
+
+// Lookups that count themselves, and note where their frames are.
+int alive = 0;
+std::set<const void*> frames_seen;
+
+struct alive_token {
+    alive_token() { ++alive; }
+    ~alive_token() { --alive; }
+};
+
+interleaved_task<int> tracked(int i)
+{
+    alive_token token;
+    frames_seen.insert(&token);
+    co_await prefetch(&token);
+    co_return i;
+}
+
+void test_exceptions()
+{
+    // makeTask throws: the lookups in flight are destroyed, and the next
+    // frame made on this thread doesn't land in the group's slot.
+    interleave_group<> group(2);
+    try {
+        group.run(10,
+            [](size_t i) {
+                if (i == 5) {
+                    throw std::runtime_error("no lookup 5");
+                }
+                return tracked(int(i));
+            },
+            [](size_t, int) {}
+        );
+        assert(false);
+    } catch (const std::runtime_error&) {
+    }
+    assert(alive == 0);
+    std::set<const void*> inSlots = std::move(frames_seen);
+    frames_seen.clear();
+    auto h = tracked(0).release();
+    h.resume();
+    assert(frames_seen.size() == 1 && !inSlots.count(*frames_seen.begin()));
+    h.destroy();
+
+    // onResult throws.
+    try {
+        group.run(10,
+            [](size_t i) { return tracked(int(i)); },
+            [](size_t i, int) {
+                if (i == 3) {
+                    throw std::runtime_error("no result 3");
+                }
+            }
+        );
+        assert(false);
+    } catch (const std::runtime_error&) {
+    }
+    assert(alive == 0);
+}
+
+int main()
+{
+    std::vector<int> v;
+    for (int i=0; i < 10000; ++i) {
+        v.push_back(3 * i);
+    }
+    std::vector<int> keys;
+    for (int i=0; i < 1000; ++i) {
+        keys.push_back((i * 7919) % 30000);
+    }
+
+    for (size_t width : {1, 4, 16}) {
+        interleave_group<> group(width);
+        std::vector<int> results(keys.size(), -1);
+        group.run(keys.size(),
+            [&](size_t i) { return lower_bound_index(v, keys[i]); },
+            [&](size_t i, int r) { results[i] = r; }
+        );
+        for (size_t i=0; i < keys.size(); ++i) {
+            int expected = std::lower_bound(v.begin(), v.end(), keys[i]) - v.begin();
+            assert(results[i] == expected);
+        }
+        std::cout << "width " << width << ": ok\n";
+    }
+
+    // A frame too big for its slot still works; it just comes from the heap.
+    interleave_group<16> tiny(2);
+    int sum = 0;
+    tiny.run(10,
+        [&](size_t i) { return lower_bound_index(v, int(i) * 300); },
+        [&](size_t, int r) { sum += r; }
+    );
+    assert(sum == 4500);
+
+    test_exceptions();
+    std::cout << "Success!\n";
+}
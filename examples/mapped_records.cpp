@@ -0,0 +1,84 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/mapped_records.h>
+#include <assert.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+static std::string write_file(const std::string& contents)
+{
+    std::string path = "/tmp/mapped_records_example.txt";
+    std::ofstream(path, std::ios::binary) << contents;
+    return path;
+}
+
+static std::vector<std::string> getline_records(const std::string& contents, char delimiter)
+{
+    std::vector<std::string> result;
+    std::istringstream in(contents);
+    for (std::string line; std::getline(in, line, delimiter); ) {
+        result.push_back(line);
+    }
+    return result;
+}
+
+int main()
+{
+    std::string contents = "alpha\nbeta\n\ngamma delta\nepsilon";
+    std::string path = write_file(contents);
+
+    // The views die with the generator's mapping; keep copies.
+    std::vector<std::string> records;
+    for (std::string_view r : mapped_records(path)) {
+        records.emplace_back(r);
+    }
+    assert((records == std::vector<std::string>{"alpha", "beta", "", "gamma delta", "epsilon"}));
+
+    // Shards of one mapping, in any number, yield every record exactly once,
+    // in order, just as std::getline does.
+    for (std::string text : {contents, contents + "\n", std::string("\n\n\n"), std::string("x"), std::string()}) {
+        for (char delimiter : {'\n', ' '}) {
+            path = write_file(text);
+            mapped_file file(path.c_str());
+            std::vector<std::string> expected = getline_records(text, delimiter);
+            for (size_t shards = 1; shards <= text.size() + 2; ++shards) {
+                std::vector<std::string> all;
+                for (size_t i = 0; i < shards; ++i) {
+                    for (std::string_view r : mapped_records(file, delimiter, i, shards)) {
+                        assert(file.data() <= r.data() && r.data() + r.size() <= file.data() + file.size());
+                        all.emplace_back(r);
+                    }
+                }
+                assert(all == expected);
+            }
+        }
+    }
+
+    // A shard out of range is rejected up front.
+    for (auto [shard, shards] : {std::pair<size_t, size_t>{0, 0}, {2, 2}, {5, 3}}) {
+        mapped_file file(path.c_str());
+        try {
+            (void)mapped_records(file, '\n', shard, shards);
+            assert(false);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    try {
+        for (std::string_view r : mapped_records("/nonexistent/file")) {
+            (void)r;
+        }
+        assert(false);
+    } catch (const std::system_error& e) {
+        assert(e.code() == std::errc::no_such_file_or_directory);
+    }
+
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,110 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_scope.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/maybe_yield.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/unique_generator.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+// On a one-thread pool, a long loop and a quick job queued behind it.
+// The loop gives the job a turn every `budget` iterations.
+
+// Holds the pool's only worker while main() queues up work behind it.
+task<void> hold(work_stealing_pool::executor ex, std::atomic<int>& state)
+{
+    co_await ex.schedule();
+    state = 1;
+    while (state != 2) {
+        std::this_thread::yield();
+    }
+}
+
+task<void> long_loop(work_stealing_pool::executor ex, std::atomic<int>& progress, int n)
+{
+    co_await ex.schedule();
+    for (int i=0; i < n; ++i) {
+        progress = i + 1;
+        co_await maybe_yield();
+    }
+}
+
+task<void> quick_job(work_stealing_pool::executor ex, std::atomic<int>& progress, int& seen)
+{
+    co_await ex.schedule();
+    seen = progress;
+}
+
+// A generator can't be requeued, but its maybe_yield() spends budget
+// that the task consuming it then pays off.
+unique_generator<int> numbers(int n)
+{
+    for (int i=0; i < n; ++i) {
+        co_await maybe_yield();
+        co_yield i;
+    }
+}
+
+task<void> consume(work_stealing_pool::executor ex, std::atomic<int>& progress, int n)
+{
+    co_await ex.schedule();
+    for (int i : numbers(n)) {
+        progress = i + 1;
+        if (i % 10 == 9) {
+            co_await maybe_yield();
+        }
+    }
+}
+
+int run(task<void> (*body)(work_stealing_pool::executor, std::atomic<int>&, int), unsigned budget)
+{
+    work_stealing_pool pool(1);
+    pool.set_yield_budget(budget);
+    auto ex = pool.get_executor();
+    std::atomic<int> progress{0};
+    int seen = -1;
+    std::atomic<int> state{0};
+    async_scope scope;
+    scope.spawn(hold(ex, state));
+    while (state != 1) {
+        std::this_thread::yield();
+    }
+    scope.spawn(body(ex, progress, 1000));
+    scope.spawn(quick_job(ex, progress, seen));
+    state = 2;
+    sync_wait(scope.join());
+    assert(progress == 1000);
+    return seen;
+}
+
+task<void> off_the_pool()
+{
+    for (int i=0; i < 1000; ++i) {
+        co_await maybe_yield();  // never suspends
+    }
+    co_return;
+}
+
+int main()
+{
+    // The quick job runs once the loop has used up its budget, not once it's done.
+    int seen = run(long_loop, 100);
+    std::cout << "quick job ran after " << seen << " iterations\n";
+    assert(seen == 100);
+    seen = run(long_loop, 10);
+    assert(seen == 10);
+
+    // The generator spends the budget; the task yields at its next check.
+    seen = run(consume, 100);
+    std::cout << "quick job ran after " << seen << " generated items\n";
+    assert(seen == 100);
+    seen = run(consume, 25);
+    assert(seen == 30);
+
+    sync_wait(off_the_pool());
+    std::cout << "Success!\n";
+}
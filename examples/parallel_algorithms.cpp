@@ -0,0 +1,182 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/parallel_algorithms.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/unique_generator.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+unique_generator<int> numbers(int n)
+{
+    for (int i=0; i < n; ++i) {
+        co_yield i;
+    }
+}
+
+// Counts the work scheduled on the pool that hasn't started yet.
+struct counting_executor {
+    work_stealing_pool::executor ex_;
+    std::atomic<int> *waiting_;
+    std::atomic<int> *maxWaiting_;
+
+    struct awaiter {
+        decltype(std::declval<work_stealing_pool::executor&>().schedule()) inner_;
+        std::atomic<int> *waiting_;
+        std::atomic<int> *maxWaiting_;
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<void> h) {
+            int n = ++*waiting_;
+            int m = maxWaiting_->load();
+            while (n > m && !maxWaiting_->compare_exchange_weak(m, n)) {}
+            inner_.await_suspend(h);
+        }
+        void await_resume() {
+            --*waiting_;
+            inner_.await_resume();
+        }
+    };
+
+    awaiter schedule() { return awaiter{ex_.schedule(), waiting_, maxWaiting_}; }
+};
+
+// However many chunks, only so many are outstanding at once.
+task<void> bounded(work_stealing_pool::executor ex)
+{
+    std::atomic<int> waiting{0};
+    std::atomic<int> maxWaiting{0};
+    counting_executor counted{ex, &waiting, &maxWaiting};
+    std::vector<int> v(100000, 1);
+    long sum = co_await parallel_transform_reduce(counted, v, 1, 0L, std::plus<>(), [](int i) { return long(i); });
+    assert(sum == 100000);
+    std::atomic<long> visited{0};
+    co_await parallel_for_each(counted, v, 1, [&](int i) { visited += i; });
+    assert(visited == 100000);
+    assert(maxWaiting <= int(parallel_batches_in_flight));
+}
+
+// While the first chunk stalls, results pile up behind it only so far:
+// transform_reduce starts no more chunks than it may hold results for.
+template<class MakeRange>
+task<void> stalled_front(work_stealing_pool::executor ex, MakeRange makeRange)
+{
+    std::atomic<int> started{0};
+    std::atomic<bool> stalled{true};
+    int startedWhileStalled = 0;
+    std::thread unstaller([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        startedWhileStalled = started;
+        stalled = false;
+    });
+    std::string s = co_await parallel_transform_reduce(ex, makeRange(), 1, std::string(),
+        std::plus<>(), [&](int i) {
+            started += 1;
+            while (i == 0 && stalled) {
+                std::this_thread::yield();
+            }
+            return std::string(1000, char('a' + i % 26));
+        });
+    unstaller.join();
+    assert(s.size() == 10000 * 1000);
+    assert(startedWhileStalled <= int(parallel_batches_in_flight));
+}
+
+struct results {
+    long squares = 0;
+    double harmonic = 0;
+    std::string letters;
+    long fromGenerator = 0;
+    std::string lettersFromGenerator;
+};
+
+task<results> compute(work_stealing_pool::executor ex)
+{
+    results r;
+    std::vector<int> v(100000);
+    co_await parallel_for_each(ex, std::views::iota(0, 100000), 1000, [&](int i) { v[i] = i; });
+    for (int i=0; i < 100000; ++i) {
+        assert(v[i] == i);
+    }
+
+    r.squares = co_await parallel_transform_reduce(ex, v, 777, 0L,
+        std::plus<>(), [](int i) { return long(i) * i; });
+
+    // Floating-point addition isn't associative, but the order is fixed.
+    r.harmonic = co_await parallel_transform_reduce(ex, std::views::iota(1, 1000000), 4096, 0.0,
+        std::plus<>(), [](int i) { return 1.0 / i; });
+
+    // Nor is string concatenation commutative.
+    r.letters = co_await parallel_transform_reduce(ex, std::views::iota(0, 260), 7, std::string(),
+        std::plus<>(), [](int i) { return std::string(1, char('a' + i % 26)); });
+
+    // An input-only source is pulled in batches by this coroutine alone.
+    std::atomic<long> sum{0};
+    co_await parallel_for_each(ex, numbers(10000), 100, [&](int i) { sum += i; });
+    assert(sum == 49995000);
+    r.fromGenerator = co_await parallel_transform_reduce(ex, numbers(10000), 64, 0L,
+        std::plus<>(), [](int i) { return long(i) * i; });
+    r.lettersFromGenerator = co_await parallel_transform_reduce(ex, numbers(260), 7, std::string(),
+        std::plus<>(), [](int i) { return std::string(1, char('a' + i % 26)); });
+
+    // Empty ranges just give back init.
+    long none = co_await parallel_transform_reduce(ex, std::vector<int>(), 10, 42L, std::plus<>(), [](int i) { return long(i); });
+    assert(none == 42);
+    none = co_await parallel_transform_reduce(ex, numbers(0), 10, 42L, std::plus<>(), [](int i) { return long(i); });
+    assert(none == 42);
+
+    // An exception comes out once every chunk is done.
+    std::atomic<int> visited{0};
+    try {
+        co_await parallel_for_each(ex, v, 100, [&](int i) {
+            visited += 1;
+            if (i == 5000) {
+                throw std::runtime_error("oops");
+            }
+        });
+        assert(false);
+    } catch (const std::runtime_error&) {
+        assert(visited >= 5001);
+    }
+    co_return r;
+}
+
+int main()
+{
+    std::string alphabet = "abcdefghijklmnopqrstuvwxyz";
+    std::string expectedLetters;
+    for (int i=0; i < 10; ++i) {
+        expectedLetters += alphabet;
+    }
+
+    std::vector<results> all;
+    for (int threads : {1, 2, 4}) {
+        work_stealing_pool pool(threads);
+        results r;
+        sync_wait([&]() -> task<void> {
+            r = co_await compute(pool.get_executor());
+        }());
+        assert(r.squares == 333328333350000L);
+        assert(r.fromGenerator == 333283335000L);
+        assert(r.letters == expectedLetters);
+        assert(r.lettersFromGenerator == expectedLetters);
+        all.push_back(r);
+        sync_wait(bounded(pool.get_executor()));
+        sync_wait(stalled_front(pool.get_executor(), []() { return std::views::iota(0, 10000); }));
+        sync_wait(stalled_front(pool.get_executor(), []() { return numbers(10000); }));
+    }
+    // Bit-for-bit the same however many threads did the work.
+    for (const results& r : all) {
+        assert(r.harmonic == all[0].harmonic);
+    }
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,206 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/any_executor.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/new_thread_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/read_ahead.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <stdlib.h>
+#include <unistd.h>
+
+static const char *path = "/tmp/read_ahead_example.bin";
+
+// read_ahead's buffers come from aligned new[], which can be told to fail.
+static std::atomic<bool> fail_next_buffer{false};
+
+void *operator new[](size_t n, std::align_val_t al)
+{
+    void *p = nullptr;
+    if (!fail_next_buffer.exchange(false) && posix_memalign(&p, size_t(al), n ? n : 1) == 0) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { free(p); }
+
+static std::string write_file(size_t size)
+{
+    std::string contents;
+    for (size_t i = 0; i < size; ++i) {
+        contents += char('a' + i % 23);
+    }
+    std::ofstream(path, std::ios::binary) << contents;
+    return contents;
+}
+
+// Reads the whole file, checking that at most `buffers` distinct buffers are ever used.
+task<std::string> read_all(any_executor ex, size_t chunkSize, size_t buffers, int openFlags = 0)
+{
+    std::string result;
+    std::set<const std::byte*> seen;
+    auto chunks = read_ahead(ex, path, chunkSize, buffers, openFlags);
+    for (auto it = co_await chunks.begin(); it != chunks.end(); co_await ++it) {
+        std::span<const std::byte> chunk = *it;
+        assert(chunk.size() <= chunkSize);
+        seen.insert(chunk.data());
+        result.append(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+    }
+    assert(seen.size() <= buffers);
+    co_return result;
+}
+
+task<size_t> read_some(any_executor ex, size_t chunks)
+{
+    size_t bytes = 0;
+    auto g = read_ahead(ex, path, 100, 3);
+    for (auto it = co_await g.begin(); it != g.end() && chunks != 0; co_await ++it, --chunks) {
+        bytes += (*it).size();
+    }
+    co_return bytes;
+}
+
+task<void> read_unallocated(any_executor ex)
+{
+    auto g = read_ahead(ex, path, 4096, 2);
+    fail_next_buffer = true;
+    try {
+        co_await g.begin();
+        assert(false);
+    } catch (const std::bad_alloc&) {
+    }
+}
+
+// The lowest file descriptor not in use.
+int lowest_free_fd()
+{
+    int fd = open("/dev/null", O_RDONLY);
+    close(fd);
+    return fd;
+}
+
+// An executor that can't schedule anything, like a new_thread_context
+// that can't start a thread.
+struct failing_executor {
+    int *attempts_;
+
+    struct awaiter {
+        int *attempts_;
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<void>) {
+            *attempts_ += 1;
+            throw std::system_error(std::make_error_code(std::errc::resource_unavailable_try_again));
+        }
+        void await_resume() {}
+    };
+
+    awaiter schedule() { return awaiter{attempts_}; }
+};
+
+task<void> read_unscheduled()
+{
+    int attempts = 0;
+    auto g = read_ahead(failing_executor{&attempts}, path, 4096, 2);
+    try {
+        co_await g.begin();
+        assert(false);
+    } catch (const std::system_error& e) {
+        assert(e.code() == std::errc::resource_unavailable_try_again);
+    }
+    assert(attempts == 2);
+}
+
+task<void> read_missing(any_executor ex)
+{
+    auto g = read_ahead(ex, "/nonexistent/file");
+    try {
+        co_await g.begin();
+        assert(false);
+    } catch (const std::system_error& e) {
+        assert(e.code() == std::errc::no_such_file_or_directory);
+    }
+}
+
+void test(any_executor ex)
+{
+    // Failing to allocate the buffers doesn't leak the file.
+    write_file(10);
+    int fd = lowest_free_fd();
+    sync_wait(read_unallocated(ex));
+    assert(lowest_free_fd() == fd);
+
+    for (size_t size : {0, 1, 4096, 10000, 12288}) {
+        std::string contents = write_file(size);
+        for (size_t buffers : {1, 2, 4}) {
+            std::string result;
+            sync_wait([&]() -> task<void> {
+                result = co_await read_all(ex, 4096, buffers);
+            }());
+            assert(result == contents);
+        }
+    }
+
+    // O_DIRECT, where the file system supports it.
+    for (size_t size : {10000, 12288}) {
+        std::string contents = write_file(size);
+        try {
+            std::string result;
+            sync_wait([&]() -> task<void> {
+                result = co_await read_all(ex, 4096, 2, O_DIRECT);
+            }());
+            assert(result == contents);
+        } catch (const std::system_error& e) {
+            assert(e.code() == std::errc::invalid_argument);
+        }
+    }
+
+    // Stopping early leaves the reads in flight to finish on their own.
+    write_file(10000);
+    size_t bytes = 0;
+    sync_wait([&]() -> task<void> {
+        bytes = co_await read_some(ex, 5);
+    }());
+    assert(bytes == 500);
+
+    sync_wait(read_missing(ex));
+
+    // Sizes that could never work are rejected up front.
+    for (auto [chunkSize, buffers] : {std::pair<size_t, size_t>(0, 2), {4096, 0}}) {
+        try {
+            (void)read_ahead(ex, path, chunkSize, buffers);
+            assert(false);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+    try {
+        (void)read_ahead(ex, path, 1000, 2, O_DIRECT);
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+}
+
+int main()
+{
+    work_stealing_pool pool(2);
+    test(pool.get_executor());
+
+    new_thread_context threads;
+    test(threads.get_executor());
+
+    sync_wait(read_unscheduled());
+
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,86 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_scope.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+using ms = std::chrono::milliseconds;
+
+// The pool's only worker is held here while main() queues up work behind it.
+task<void> hold(work_stealing_pool::executor ex, std::atomic<int>& state)
+{
+    co_await ex.schedule();
+    state = 1;
+    while (state != 2) {
+        std::this_thread::yield();
+    }
+}
+
+task<void> batch(work_stealing_pool::executor ex, std::vector<int>& order, int id)
+{
+    co_await ex.schedule();
+    order.push_back(id);
+}
+
+task<void> urgent(work_stealing_pool::executor ex, std::vector<int>& order, int id, clock_type::time_point deadline)
+{
+    co_await ex.schedule_by(deadline);
+    order.push_back(id);
+}
+
+std::vector<int> run(void (*enqueue)(async_scope&, work_stealing_pool::executor, std::vector<int>&))
+{
+    work_stealing_pool pool(1);
+    auto ex = pool.get_executor();
+    std::vector<int> order;
+    std::atomic<int> state{0};
+    async_scope scope;
+    scope.spawn(hold(ex, state));
+    while (state != 1) {
+        std::this_thread::yield();
+    }
+    enqueue(scope, ex, order);
+    state = 2;
+    sync_wait(scope.join());
+    return order;
+}
+
+int main()
+{
+    // Deadline work goes first, earliest deadline first; ties in order of arrival.
+    auto order = run([](async_scope& scope, work_stealing_pool::executor ex, std::vector<int>& order) {
+        auto now = clock_type::now();
+        scope.spawn(batch(ex, order, 1));
+        scope.spawn(urgent(ex, order, 10, now + ms(30)));
+        scope.spawn(batch(ex, order, 2));
+        scope.spawn(urgent(ex, order, 11, now + ms(10)));
+        scope.spawn(urgent(ex, order, 12, now + ms(20)));
+        scope.spawn(urgent(ex, order, 13, now + ms(10)));
+    });
+    assert((order == std::vector<int>{11, 13, 12, 10, 1, 2}));
+
+    // A flood of deadlines doesn't starve the rest: every
+    // lane_streak_limit lane items, something else gets a turn.
+    order = run([](async_scope& scope, work_stealing_pool::executor ex, std::vector<int>& order) {
+        auto now = clock_type::now();
+        scope.spawn(batch(ex, order, 1));
+        scope.spawn(batch(ex, order, 2));
+        for (int i=0; i < 40; ++i) {
+            scope.spawn(urgent(ex, order, 100 + i, now));
+        }
+    });
+    const int limit = work_stealing_pool::lane_streak_limit;
+    assert(order.size() == 42);
+    assert(order[limit] == 1);
+    assert(order[2 * limit + 1] == 2);
+    assert(order[limit + 1] == 100 + limit);
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,178 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/new_thread_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/schedule_on.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+// The pool is for CPU-bound work; each "I/O" happens on a thread of its own,
+// and whatever follows it shouldn't stay there.
+
+using cpu_executor = work_stealing_pool::executor;
+using io_executor = new_thread_context::executor;
+
+task<int> read_block(io_executor io, int n)
+{
+    co_await io.schedule();
+    assert(io.running_in_this_thread());
+    co_return n * 100;
+}
+
+task<int> checksum(cpu_executor cpu, int n)
+{
+    assert(cpu.running_in_this_thread());
+    co_return n + 1;
+}
+
+task<int> failing_read(io_executor io)
+{
+    co_await io.schedule();
+    throw std::runtime_error("disk on fire");
+}
+
+task<int, std::string> read_or_error(io_executor io, bool ok)
+{
+    co_await io.schedule();
+    if (!ok) {
+        co_return error(std::string("not found"));
+    }
+    co_return 7;
+}
+
+task<int, std::string> lookup(cpu_executor cpu, io_executor io, bool ok)
+{
+    int x = co_await resume_on(cpu, read_or_error(io, ok));
+    assert(cpu.running_in_this_thread());
+    co_return x * 2;
+}
+
+task<void> without_adaptors(cpu_executor cpu, io_executor io)
+{
+    co_await cpu.schedule();
+    co_await read_block(io, 1);
+    // The I/O thread resumed us, and here we still are.
+    assert(!cpu.running_in_this_thread());
+}
+
+task<void> with_adaptors(work_stealing_pool& pool, io_executor io)
+{
+    cpu_executor cpu = pool.get_executor();
+
+    // schedule_on starts a task somewhere else...
+    int a = co_await schedule_on(cpu, checksum(cpu, 1));
+    assert(a == 2);
+
+    // ...and resume_on brings its awaiter back.
+    int b = co_await resume_on(cpu, read_block(io, 2));
+    assert(b == 200);
+    assert(cpu.running_in_this_thread());
+
+    // Neither hops when it's already where it's going.
+    uint64_t scheduled = pool.metrics().scheduled_;
+    int c = co_await resume_on(cpu, schedule_on(cpu, checksum(cpu, 3)));
+    assert(c == 4);
+    assert(pool.metrics().scheduled_ == scheduled);
+
+    // Exceptions and errors come back the same way.
+    try {
+        co_await resume_on(cpu, failing_read(io));
+        assert(false);
+    } catch (const std::runtime_error& ex) {
+        assert(cpu.running_in_this_thread());
+        assert(std::string(ex.what()) == "disk on fire");
+    }
+    auto t = lookup(cpu, io, false);
+    co_await t.when_ready();
+    assert(t.failed() && t.error() == "not found");
+    auto u = lookup(cpu, io, true);
+    co_await u.when_ready();
+    assert(!u.failed() && u.get() == 14);
+}
+
+task<void> at_home(work_stealing_pool& pool, io_executor io)
+{
+    cpu_executor cpu = pool.get_executor();
+    co_await home_on(cpu);
+    assert(cpu.running_in_this_thread());
+
+    // Every task we await comes home, without being told to.
+    for (int i=0; i < 3; ++i) {
+        int n = co_await read_block(io, i);
+        assert(n == i * 100);
+        assert(cpu.running_in_this_thread());
+    }
+
+    // Tasks that finish at home don't hop at all.
+    uint64_t scheduled = pool.metrics().scheduled_;
+    co_await home_on(cpu);
+    int n = co_await checksum(cpu, 5);
+    assert(n == 6);
+    assert(pool.metrics().scheduled_ == scheduled);
+}
+
+// A home executor that can be told to fail, as new_thread_context does
+// when it can't start a thread.
+struct flaky_home {
+    cpu_executor cpu_;
+    bool fail_ = false;
+};
+
+struct flaky_executor {
+    flaky_home *home_;
+
+    struct awaiter {
+        flaky_home *home_;
+        decltype(std::declval<cpu_executor&>().schedule()) inner_;
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<void> h) {
+            if (home_->fail_) {
+                throw std::runtime_error("no way home");
+            }
+            inner_.await_suspend(h);
+        }
+        void await_resume() { inner_.await_resume(); }
+    };
+
+    awaiter schedule() { return awaiter{home_, home_->cpu_.schedule()}; }
+    bool running_in_this_thread() const noexcept { return home_->cpu_.running_in_this_thread(); }
+};
+
+task<void> failing_home(work_stealing_pool& pool, io_executor io)
+{
+    flaky_home home{pool.get_executor()};
+    co_await home_on(flaky_executor{&home});
+    assert(pool.get_executor().running_in_this_thread());
+
+    // The hop home fails where the awaiter can see it, not in final_suspend.
+    home.fail_ = true;
+    try {
+        co_await read_block(io, 1);
+        assert(false);
+    } catch (const std::runtime_error& ex) {
+        assert(std::string(ex.what()) == "no way home");
+        assert(io.running_in_this_thread());
+    }
+
+    home.fail_ = false;
+    int n = co_await read_block(io, 2);
+    assert(n == 200);
+    assert(pool.get_executor().running_in_this_thread());
+}
+
+int main()
+{
+    work_stealing_pool pool(2);
+    new_thread_context io;
+    sync_wait(without_adaptors(pool.get_executor(), io.get_executor()));
+    sync_wait(with_adaptors(pool, io.get_executor()));
+    sync_wait(at_home(pool, io.get_executor()));
+    sync_wait(failing_home(pool, io.get_executor()));
+    std::cout << "Success!\n";
+}
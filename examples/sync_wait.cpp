@@ -0,0 +1,75 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_scope.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+task<int> square(work_stealing_pool::executor ex, int i)
+{
+    co_await ex.schedule();
+    co_return i * i;
+}
+
+// Blocks a worker in sync_wait() on work that needs a worker to run it.
+// With every worker doing this, nothing would be left to run the squares;
+// instead, each blocked worker runs queued work (maybe its own square,
+// maybe someone else's) until its own result is ready.
+task<void> blocking_caller(work_stealing_pool::executor ex, int i, std::atomic<int>& sum)
+{
+    co_await ex.schedule();
+    int result = 0;
+    sync_wait([&]() -> task<void> {
+        result = co_await square(ex, i);
+    }());
+    assert(result == i * i);
+    sum += result;
+}
+
+// sync_wait() nests: the helped work may block in sync_wait() itself.
+task<int> nested(work_stealing_pool::executor ex, int depth)
+{
+    co_await ex.schedule();
+    if (depth == 0) {
+        co_return 0;
+    }
+    int result = 0;
+    sync_wait([&]() -> task<void> {
+        result = co_await nested(ex, depth - 1);
+    }());
+    co_return result + 1;
+}
+
+int main()
+{
+    // On the calling thread, sync_wait() just blocks.
+    int r = 0;
+    std::thread t([&]() {
+        sync_wait([&]() -> task<void> { r = 42; co_return; }());
+    });
+    t.join();
+    assert(r == 42);
+
+    for (int threads : {1, 2}) {
+        work_stealing_pool pool(threads);
+        auto ex = pool.get_executor();
+        std::atomic<int> sum{0};
+        async_scope scope;
+        for (int i=1; i <= 100; ++i) {
+            scope.spawn(blocking_caller(ex, i, sum));
+        }
+        sync_wait(scope.join());
+        assert(sum == 338350);
+
+        int depth = 0;
+        sync_wait([&]() -> task<void> {
+            depth = co_await nested(ex, 20);
+        }());
+        assert(depth == 20);
+    }
+    std::cout << "Success!\n";
+}
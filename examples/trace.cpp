@@ -0,0 +1,120 @@
+// https://coro.godbolt.org/z/
+
+#define CORO_TRACE 1
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/new_thread_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/timer_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/trace.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/unique_generator.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Run with a filename argument to write the trace there, and load it into
+// https://ui.perfetto.dev or chrome://tracing.
+
+unique_generator<int> squares(int n)
+{
+    for (int i=0; i < n; ++i) {
+        co_yield i * i;
+    }
+}
+
+task<int> lookup(work_stealing_pool::executor ex, timer_context::executor timers, int id)
+{
+    co_await timers.schedule_after(std::chrono::milliseconds(1));
+    co_await ex.schedule();
+    int sum = 0;
+    for (int x : squares(id)) {
+        sum += x;
+    }
+    co_return sum;
+}
+
+task<int> handle_request(work_stealing_pool::executor ex, timer_context::executor timers, int id)
+{
+    co_await ex.schedule();
+    int a = co_await lookup(ex, timers, id);
+    int b = co_await lookup(ex, timers, id + 1);
+    co_return a + b;
+}
+
+task<void> serve(work_stealing_pool::executor ex, timer_context::executor timers)
+{
+    for (int id = 1; id <= 10; ++id) {
+        int result = co_await handle_request(ex, timers, id);
+        assert(result == (id - 1) * id * (2 * id - 1) / 6 + id * (id + 1) * (2 * id + 1) / 6);
+    }
+}
+
+// Every hop starts a new thread, which records a few events and exits.
+task<void> hop(new_thread_context::executor ex, int hops)
+{
+    for (int i=0; i < hops; ++i) {
+        co_await ex.schedule();
+    }
+}
+
+int count(const std::string& s, const std::string& needle)
+{
+    int n = 0;
+    for (size_t pos = s.find(needle); pos != std::string::npos; pos = s.find(needle, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    if (true) {
+        work_stealing_pool pool(4);
+        timer_context timers;
+        sync_wait(serve(pool.get_executor(), timers.get_executor()));
+    }
+
+    // Every thread is done, so every slice has ended, and every
+    // scheduled coroutine has run.
+    std::ostringstream os;
+    trace_flush(os);
+    std::string json = os.str();
+    assert(count(json, "\"ph\":\"B\"") == count(json, "\"ph\":\"E\""));
+    assert(count(json, "\"ph\":\"s\"") == count(json, "\"ph\":\"f\""));
+    assert(count(json, "\"name\":\"create task\"") == 1 + 10 * 3);
+    assert(count(json, "\"name\":\"destroy task\"") == 1 + 10 * 3);
+    assert(count(json, "\"name\":\"complete unique_generator\"") == 20);
+    assert(count(json, "\"ph\":\"s\",\"cat\":\"schedule\",\"name\":\"timer_context\"") == 20);
+    std::cout << count(json, "\"ph\":") << " trace events\n";
+
+    // A second flush starts where the first left off. The pool's and the
+    // timer's threads have exited, so the first flush freed their buffers.
+    std::ostringstream again;
+    trace_flush(again);
+    assert(count(again.str(), "\"ph\":\"B\"") == 0);
+    assert(count(again.str(), "\"thread_name\"") == 1);
+
+    // Under thread churn, each flush frees the buffers of the threads
+    // that have exited since the one before.
+    for (int round = 0; round < 10; ++round) {
+        if (true) {
+            new_thread_context threads;
+            sync_wait(hop(threads.get_executor(), 20));
+        }
+        std::ostringstream churn;
+        trace_flush(churn);
+        assert(count(churn.str(), "\"thread_name\"") == 1 + 20);
+    }
+    std::ostringstream last;
+    trace_flush(last);
+    assert(count(last.str(), "\"thread_name\"") == 1);
+
+    if (argc > 1) {
+        std::ofstream(argv[1]) << json;
+    }
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,176 @@
+// https://coro.godbolt.org/z/
+
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/async_scope.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/schedule_on.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/sync_wait.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/task.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/timer_context.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/with_timeout.h>
+#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/include/coro/work_stealing_pool.h>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using ms = std::chrono::milliseconds;
+
+static int live_frames = 0;
+
+struct frame_counter {
+    frame_counter() { ++live_frames; }
+    ~frame_counter() { --live_frames; }
+};
+
+// One step of work: a millisecond's nap, unless we've been asked to stop.
+task<bool> step(timer_context::executor timers)
+{
+    frame_counter c;
+    std::stop_token token = co_await get_stop_token();
+    if (token.stop_requested()) {
+        co_return false;
+    }
+    co_await timers.schedule_after(ms(1));
+    co_return true;
+}
+
+task<int> count_steps(timer_context::executor timers, int n)
+{
+    frame_counter c;
+    int i = 0;
+    while (i < n && co_await step(timers)) {
+        ++i;
+    }
+    co_return i;
+}
+
+task<int> stubborn(timer_context::executor timers, int n)
+{
+    frame_counter c;
+    for (int i=0; i < n; ++i) {
+        co_await timers.schedule_after(ms(1));
+    }
+    co_return n;
+}
+
+task<int> throws(timer_context::executor timers)
+{
+    co_await timers.schedule_after(ms(1));
+    throw std::runtime_error("oops");
+}
+
+// The error propagates through a task<T, timed_out> without a throw.
+task<int, timed_out> outer(timer_context::executor timers, int n)
+{
+    int steps = co_await with_timeout(timers, count_steps(timers, n), ms(20));
+    co_return steps * 10;
+}
+
+task<void> test(timer_context::executor timers)
+{
+    // Finishes in time: the timer is disarmed, and t's value comes back.
+    auto t1 = with_timeout(timers, count_steps(timers, 5), ms(1000));
+    co_await t1.when_ready();
+    assert(!t1.failed() && t1.get() == 5);
+
+    // Runs out of time: every frame has unwound by the time we see timed_out.
+    auto t2 = with_timeout(timers, count_steps(timers, 100000), ms(20));
+    co_await t2.when_ready();
+    assert(t2.failed());
+    assert(live_frames == 0);
+
+    // Ignoring the stop token only makes the timeout late, never unsafe.
+    auto t3 = with_timeout(timers, stubborn(timers, 50), ms(5));
+    co_await t3.when_ready();
+    assert(t3.failed());
+    assert(live_frames == 0);
+
+    // An exception that beats the deadline comes through as is.
+    try {
+        co_await with_timeout(timers, throws(timers), ms(1000));
+        assert(false);
+    } catch (const std::runtime_error&) {
+    }
+
+    // Awaited by a task that can't take the error, a timeout throws.
+    try {
+        co_await with_timeout(timers, count_steps(timers, 100000), ms(5));
+        assert(false);
+    } catch (const task_error<timed_out>&) {
+    }
+
+    auto t4 = outer(timers, 3);
+    co_await t4.when_ready();
+    assert(!t4.failed() && t4.get() == 30);
+    auto t5 = outer(timers, 100000);
+    co_await t5.when_ready();
+    assert(t5.failed());
+
+    // An inner timeout is stopped along with the outer one.
+    auto t6 = with_timeout(timers, [](timer_context::executor timers) -> task<int> {
+        auto inner = with_timeout(timers, count_steps(timers, 100000), ms(100000));
+        co_await inner.when_ready();
+        co_return inner.failed() ? -1 : inner.get();
+    }(timers), ms(20));
+    auto start = timer_context::clock::now();
+    co_await t6.when_ready();
+    assert(t6.failed());
+    assert(timer_context::clock::now() - start < ms(10000));
+    assert(live_frames == 0);
+
+    // So is a task that has a home executor of its own.
+    auto t7 = with_timeout(timers, [](timer_context::executor timers) -> task<int> {
+        co_await home_on(timers);
+        co_return co_await count_steps(timers, 100000);
+    }(timers), ms(20));
+    start = timer_context::clock::now();
+    co_await t7.when_ready();
+    assert(t7.failed());
+    assert(timer_context::clock::now() - start < ms(10000));
+    assert(live_frames == 0);
+}
+
+// Holds up the timer thread at deadline, with the timer of the
+// with_timeout armed just after it already collected as due.
+task<void> hold_up_timers(timer_context::executor timers, timer_context::clock::time_point deadline, std::atomic<bool>& holding)
+{
+    co_await timers.schedule_at(deadline);
+    holding = true;
+    std::this_thread::sleep_for(ms(5));
+}
+
+task<int> finish_while_held(work_stealing_pool::executor cpu, std::atomic<bool>& holding)
+{
+    co_await cpu.schedule();
+    while (!holding) {
+        std::this_thread::yield();
+    }
+    co_return 1;
+}
+
+// t finishes after its timer is due but before it has fired, so it's too
+// late to disarm: the result still comes back where t finished, not on the
+// timer thread.
+task<void> test_late_disarm(timer_context::executor timers, work_stealing_pool::executor cpu)
+{
+    co_await cpu.schedule();
+    for (int i=0; i < 5; ++i) {
+        std::atomic<bool> holding{false};
+        async_scope scope;
+        scope.spawn(hold_up_timers(timers, timer_context::clock::now() + ms(2), holding));
+        auto t = with_timeout(timers, finish_while_held(cpu, holding), ms(2));
+        co_await t.when_ready();
+        assert(cpu.running_in_this_thread());
+        co_await scope.join();
+    }
+}
+
+int main()
+{
+    timer_context timers;
+    sync_wait(test(timers.get_executor()));
+    work_stealing_pool pool(1);
+    sync_wait(test_late_disarm(timers.get_executor(), pool.get_executor()));
+    std::cout << "Success!\n";
+}
@@ -0,0 +1,148 @@
+#ifndef INCLUDED_CORO_ANY_EXECUTOR_H
+#define INCLUDED_CORO_ANY_EXECUTOR_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// any_executor is a type-erased Executor, so that a function taking an
+// executor needn't be a template. It holds any executor no bigger than a
+// pointer, trivially copyable, and whose schedule() awaiter fits in
+// awaiter_size bytes (which covers every executor in this library) inline,
+// and dispatches through a static table of function pointers; it never
+// allocates. Its schedule() awaitable holds the erased executor's own
+// awaiter inline, and forwards each await_* call to it through that table.
+//
+// A default-constructed any_executor is empty, and mustn't be scheduled on.
+// running_in_this_thread() is false if the executor has no such method.
+
+class any_executor {
+public:
+    static constexpr size_t awaiter_size = 64;
+
+private:
+    struct vtable {
+        bool (*runningHere_)(const void *ex) noexcept;
+        void (*construct_)(void *aw, const void *ex);
+        void (*move_)(void *to, void *from) noexcept;
+        void (*destroy_)(void *aw) noexcept;
+        bool (*ready_)(void *aw);
+        std::coroutine_handle<void> (*suspend_)(void *aw, std::coroutine_handle<void> h);
+        void (*resume_)(void *aw);
+    };
+
+    template<class Ex>
+    static Ex& get(const void *ex) noexcept {
+        return *std::launder(static_cast<Ex*>(const_cast<void*>(ex)));
+    }
+
+    template<class Ex, class Aw = decltype(std::declval<Ex&>().schedule())>
+    static constexpr vtable vtable_for = {
+        [](const void *ex) noexcept {
+            if constexpr (requires { get<Ex>(ex).running_in_this_thread(); }) {
+                return bool(get<Ex>(ex).running_in_this_thread());
+            } else {
+                return false;
+            }
+        },
+        [](void *aw, const void *ex) {
+            ::new (aw) Aw(get<Ex>(ex).schedule());
+        },
+        [](void *to, void *from) noexcept {
+            ::new (to) Aw(std::move(*std::launder(static_cast<Aw*>(from))));
+        },
+        [](void *aw) noexcept {
+            std::launder(static_cast<Aw*>(aw))->~Aw();
+        },
+        [](void *aw) {
+            return bool(std::launder(static_cast<Aw*>(aw))->await_ready());
+        },
+        [](void *aw, std::coroutine_handle<void> h) -> std::coroutine_handle<void> {
+            Aw& a = *std::launder(static_cast<Aw*>(aw));
+            using R = decltype(a.await_suspend(h));
+            if constexpr (std::is_void_v<R>) {
+                a.await_suspend(h);
+                return std::noop_coroutine();
+            } else if constexpr (std::is_same_v<R, bool>) {
+                return a.await_suspend(h) ? std::noop_coroutine() : h;
+            } else {
+                return a.await_suspend(h);
+            }
+        },
+        [](void *aw) {
+            std::launder(static_cast<Aw*>(aw))->await_resume();
+        },
+    };
+
+public:
+    class schedule_awaitable {
+    public:
+        explicit schedule_awaitable(const vtable *vt, const void *ex) : vtable_(vt) {
+            vtable_->construct_(awaiter_, ex);
+        }
+
+        schedule_awaitable(schedule_awaitable&& rhs) noexcept : vtable_(rhs.vtable_) {
+            vtable_->move_(awaiter_, rhs.awaiter_);
+        }
+
+        ~schedule_awaitable() {
+            vtable_->destroy_(awaiter_);
+        }
+
+        bool await_ready() { return vtable_->ready_(awaiter_); }
+
+        std::coroutine_handle<void> await_suspend(std::coroutine_handle<void> h) {
+            return vtable_->suspend_(awaiter_, h);
+        }
+
+        void await_resume() { vtable_->resume_(awaiter_); }
+
+    private:
+        const vtable *vtable_;
+        alignas(std::max_align_t) unsigned char awaiter_[awaiter_size];
+    };
+
+    any_executor() noexcept = default;
+
+    template<class Ex>
+        requires (!std::is_same_v<Ex, any_executor> && requires (Ex& ex) { ex.schedule(); })
+    any_executor(Ex ex) noexcept : vtable_(&vtable_for<Ex>) {
+        using Aw = decltype(ex.schedule());
+        static_assert(sizeof(Ex) <= sizeof(ex_) && alignof(Ex) <= alignof(void*),
+            "any_executor stores only executors the size of a pointer");
+        static_assert(std::is_trivially_copyable_v<Ex>,
+            "any_executor stores only trivially copyable executors");
+        static_assert(sizeof(Aw) <= awaiter_size && alignof(Aw) <= alignof(std::max_align_t),
+            "the executor's schedule() awaiter is too big for any_executor");
+        ::new (static_cast<void*>(ex_)) Ex(ex);
+    }
+
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
+
+    schedule_awaitable schedule() const {
+        return schedule_awaitable(vtable_, ex_);
+    }
+
+    bool running_in_this_thread() const noexcept {
+        return vtable_->runningHere_(ex_);
+    }
+
+private:
+    const vtable *vtable_ = nullptr;
+    alignas(void*) unsigned char ex_[sizeof(void*)];
+};
+
+#endif // INCLUDED_CORO_ANY_EXECUTOR_H
@@ -0,0 +1,111 @@
+#ifndef INCLUDED_CORO_ASYNC_BARRIER_H
+#define INCLUDED_CORO_ASYNC_BARRIER_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+
+// async_barrier is a reusable rendezvous point for a fixed number of
+// coroutines, like std::barrier, except that arriving and waiting is a
+// co_await instead of a blocked thread.
+//
+// co_await b.arrive_and_wait() suspends until all expected participants of
+// the current phase have arrived. The last one to arrive runs the completion
+// function, starts the next phase, and resumes the others in one batch on
+// its own thread; it continues without ever suspending.
+// Waiters are intrusive nodes in the suspended coroutines' frames.
+
+struct async_barrier_noop_completion {
+    void operator()() noexcept {}
+};
+
+template<class CompletionFunction = async_barrier_noop_completion>
+class async_barrier {
+    class awaiter;
+public:
+    explicit async_barrier(std::ptrdiff_t expected, CompletionFunction f = CompletionFunction()) :
+        expected_(expected),
+        remaining_(expected),
+        completion_(std::move(f))
+    {}
+
+    async_barrier(const async_barrier&) = delete;
+    async_barrier& operator=(const async_barrier&) = delete;
+
+    awaiter arrive_and_wait() noexcept {
+        return awaiter(this);
+    }
+
+    // Arrive at the current phase without waiting for it, and leave the
+    // set of participants expected in later phases.
+    void arrive_and_drop() {
+        std::unique_lock<std::mutex> lk(mut_);
+        --expected_;
+        arrive(lk);
+    }
+
+private:
+    class awaiter {
+    public:
+        explicit awaiter(async_barrier *barrier) noexcept : barrier_(barrier) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<void> h) {
+            coro_ = h;
+            std::unique_lock<std::mutex> lk(barrier_->mut_);
+            if (barrier_->remaining_ == 1) {
+                barrier_->arrive(lk);
+                return false;
+            }
+            --barrier_->remaining_;
+            next_ = barrier_->waiters_;
+            barrier_->waiters_ = this;
+            return true;
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        friend class async_barrier;
+        async_barrier *barrier_;
+        awaiter *next_ = nullptr;
+        std::coroutine_handle<void> coro_;
+    };
+
+    // Called with mut_ held, by an arrival that may be the last of its phase.
+    void arrive(std::unique_lock<std::mutex>& lk) {
+        if (--remaining_ > 0) {
+            return;
+        }
+        completion_();
+        remaining_ = expected_;
+        awaiter *waiters = std::exchange(waiters_, nullptr);
+        lk.unlock();
+        while (waiters != nullptr) {
+            awaiter *next = waiters->next_;
+            waiters->coro_.resume();
+            waiters = next;
+        }
+    }
+
+    std::mutex mut_;
+    std::ptrdiff_t expected_;
+    std::ptrdiff_t remaining_;
+    awaiter *waiters_ = nullptr;
+    CompletionFunction completion_;
+};
+
+#endif // INCLUDED_CORO_ASYNC_BARRIER_H
@@ -0,0 +1,203 @@
+#ifndef INCLUDED_CORO_ASYNC_GENERATOR_H
+#define INCLUDED_CORO_ASYNC_GENERATOR_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#ifdef CORO_FRAME_PROFILE
+#include "frame_profile.h"
+#endif
+#ifdef CORO_TRACE
+#include "trace.h"
+#elif !defined(INCLUDED_CORO_TRACE_HOOKS)
+#define INCLUDED_CORO_TRACE_HOOKS
+// trace.h's hooks, which do nothing without -DCORO_TRACE.
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // CORO_TRACE
+
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// async_generator<Ref> is a generator that can also co_await between its
+// co_yields, so its consumer must co_await it in turn:
+//
+//     for (auto it = co_await g.begin(); it != g.end(); co_await ++it) {
+//         use(*it);
+//     }
+//
+// Each co_await of begin() or ++it runs the generator, by symmetric
+// transfer, to its next co_yield (or its end), which transfers straight
+// back. If the generator suspends on something in between, the consumer
+// resumes on whichever thread resumed the generator.
+//
+// A yielded value lives in the generator's frame until the consumer asks
+// for the next one. An exception escaping the generator is rethrown from
+// the consumer's co_await. This generator is move-only.
+
+template<class Ref, class Value = std::remove_cvref_t<Ref>>
+class async_generator {
+public:
+    class promise_type
+#ifdef CORO_FRAME_PROFILE
+        : public frame_profiled<promise_type>
+#endif
+    {
+    public:
+        promise_type() noexcept {
+            trace_promise(trace_event::create, "async_generator", *this);
+        }
+
+        ~promise_type() {
+            trace_promise(trace_event::destroy, "async_generator", *this);
+        }
+
+        async_generator get_return_object() noexcept {
+            return async_generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept { return to_consumer{}; }
+
+        auto yield_value(std::remove_reference_t<Ref>& ref) noexcept {
+            value_ = std::addressof(ref);
+            return to_consumer{};
+        }
+
+        auto yield_value(std::remove_reference_t<Ref>&& ref) noexcept {
+            value_ = std::addressof(ref);
+            return to_consumer{};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept {
+            error_ = std::current_exception();
+        }
+
+    private:
+        friend class async_generator;
+
+        struct to_consumer {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<void> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                return h.promise().consumer_;
+            }
+            void await_resume() noexcept {}
+        };
+
+        std::remove_reference_t<Ref> *value_ = nullptr;
+        std::coroutine_handle<void> consumer_;
+        std::exception_ptr error_;
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    async_generator(async_generator&& g) noexcept :
+        coro_(std::exchange(g.coro_, {}))
+    {}
+
+    ~async_generator() {
+        if (coro_) {
+            coro_.destroy();
+        }
+    }
+
+    struct sentinel {};
+
+    class iterator;
+
+    // What begin() and ++it return: runs the generator to its next co_yield.
+    class advance_awaiter {
+    public:
+        explicit advance_awaiter(handle_t coro) noexcept : coro_(coro) {}
+
+        bool await_ready() noexcept { return false; }
+
+        std::coroutine_handle<void> await_suspend(std::coroutine_handle<void> h) noexcept {
+            coro_.promise().consumer_ = h;
+            return coro_;
+        }
+
+        iterator await_resume() {
+            if (coro_.done()) {
+                if (auto e = std::exchange(coro_.promise().error_, nullptr)) {
+                    std::rethrow_exception(std::move(e));
+                }
+            }
+            return iterator(coro_);
+        }
+
+    private:
+        handle_t coro_;
+    };
+
+    class iterator {
+    public:
+        using reference = Ref;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::add_pointer_t<Ref>;
+        using iterator_category = std::input_iterator_tag;
+
+        iterator() noexcept {}
+
+        explicit iterator(handle_t coro) noexcept :
+            coro_(coro)
+        {}
+
+        reference operator*() const {
+            return static_cast<reference>(*coro_.promise().value_);
+        }
+
+        advance_awaiter operator++() noexcept {
+            return advance_awaiter(coro_);
+        }
+
+        friend bool operator==(const iterator& it, sentinel) noexcept { return it.coro_.done(); }
+        friend bool operator==(sentinel, const iterator& it) noexcept { return it.coro_.done(); }
+        friend bool operator!=(const iterator& it, sentinel) noexcept { return !it.coro_.done(); }
+        friend bool operator!=(sentinel, const iterator& it) noexcept { return !it.coro_.done(); }
+
+    private:
+        handle_t coro_;
+    };
+
+    advance_awaiter begin() noexcept {
+        return advance_awaiter(coro_);
+    }
+
+    sentinel end() noexcept {
+        return {};
+    }
+
+private:
+    explicit async_generator(handle_t coro) noexcept :
+        coro_(coro)
+    {}
+
+    handle_t coro_;
+};
+
+#endif // INCLUDED_CORO_ASYNC_GENERATOR_H
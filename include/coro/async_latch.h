@@ -0,0 +1,55 @@
+#ifndef INCLUDED_CORO_ASYNC_LATCH_H
+#define INCLUDED_CORO_ASYNC_LATCH_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "async_manual_reset_event.h"
+
+#include <atomic>
+#include <cstddef>
+
+// async_latch is a single-use countdown, like std::latch, except that
+// waiting for it is a co_await instead of a blocked thread.
+// Once the count reaches zero, every waiter is resumed in one batch on the
+// thread that made the final count_down(), and later awaits complete immediately.
+
+class async_latch {
+public:
+    explicit async_latch(std::ptrdiff_t expected) noexcept :
+        count_(expected),
+        event_(expected <= 0)
+    {}
+
+    async_latch(const async_latch&) = delete;
+    async_latch& operator=(const async_latch&) = delete;
+
+    void count_down(std::ptrdiff_t n = 1) noexcept {
+        if (count_.fetch_sub(n, std::memory_order_acq_rel) == n) {
+            event_.set();
+        }
+    }
+
+    bool try_wait() const noexcept {
+        return event_.is_set();
+    }
+
+    auto operator co_await() const noexcept {
+        return event_.operator co_await();
+    }
+
+private:
+    std::atomic<std::ptrdiff_t> count_;
+    async_manual_reset_event event_;
+};
+
+#endif // INCLUDED_CORO_ASYNC_LATCH_H
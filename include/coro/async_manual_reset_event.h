@@ -0,0 +1,113 @@
+#ifndef INCLUDED_CORO_ASYNC_MANUAL_RESET_EVENT_H
+#define INCLUDED_CORO_ASYNC_MANUAL_RESET_EVENT_H
+
+// Original source:
+// https://github.com/lewissbaker/cppcoro/blob/master/include/cppcoro/async_manual_reset_event.hpp
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include <atomic>
+
+// async_manual_reset_event is a flag that coroutines can co_await.
+// Awaiting a set event completes immediately; awaiting an unset event
+// suspends until somebody calls set(). The event stays set until reset().
+//
+// The whole state is one atomic pointer: "this" means set, nullptr means
+// unset with nobody waiting, and anything else is the head of an intrusive
+// list of awaiters living in the suspended coroutines' frames.
+// set() takes the entire list in one exchange and resumes every waiter,
+// in the order they arrived, on the setting thread.
+
+class async_manual_reset_event {
+    class awaiter;
+public:
+    explicit async_manual_reset_event(bool initiallySet = false) noexcept :
+        state_(initiallySet ? static_cast<void*>(this) : nullptr)
+    {}
+
+    async_manual_reset_event(const async_manual_reset_event&) = delete;
+    async_manual_reset_event& operator=(const async_manual_reset_event&) = delete;
+
+    bool is_set() const noexcept {
+        return state_.load(std::memory_order_acquire) == this;
+    }
+
+    void set() noexcept {
+        void *old = state_.exchange(this, std::memory_order_acq_rel);
+        if (old == this) {
+            return;
+        }
+        // The list was pushed LIFO; reverse it so waiters resume in FIFO order.
+        awaiter *waiters = nullptr;
+        for (awaiter *w = static_cast<awaiter*>(old); w != nullptr; ) {
+            awaiter *next = w->next_;
+            w->next_ = waiters;
+            waiters = w;
+            w = next;
+        }
+        while (waiters != nullptr) {
+            awaiter *next = waiters->next_;
+            waiters->coro_.resume();
+            waiters = next;
+        }
+    }
+
+    // Resetting an event that has waiters (and therefore isn't set) does nothing.
+    void reset() noexcept {
+        void *old = this;
+        state_.compare_exchange_strong(old, nullptr, std::memory_order_relaxed);
+    }
+
+    awaiter operator co_await() const noexcept;
+
+private:
+    class awaiter {
+    public:
+        explicit awaiter(const async_manual_reset_event *event) noexcept : event_(event) {}
+
+        bool await_ready() const noexcept {
+            return event_->is_set();
+        }
+
+        bool await_suspend(std::coroutine_handle<void> h) noexcept {
+            coro_ = h;
+            const void *set = event_;
+            void *old = event_->state_.load(std::memory_order_acquire);
+            do {
+                if (old == set) {
+                    return false;
+                }
+                next_ = static_cast<awaiter*>(old);
+            } while (!event_->state_.compare_exchange_weak(
+                old, static_cast<void*>(this), std::memory_order_release, std::memory_order_acquire));
+            return true;
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        friend class async_manual_reset_event;
+        const async_manual_reset_event *event_;
+        awaiter *next_ = nullptr;
+        std::coroutine_handle<void> coro_;
+    };
+
+    mutable std::atomic<void*> state_;
+};
+
+inline auto async_manual_reset_event::operator co_await() const noexcept -> awaiter
+{
+    return awaiter(this);
+}
+
+#endif // INCLUDED_CORO_ASYNC_MANUAL_RESET_EVENT_H
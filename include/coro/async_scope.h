@@ -0,0 +1,154 @@
+#ifndef INCLUDED_CORO_ASYNC_SCOPE_H
+#define INCLUDED_CORO_ASYNC_SCOPE_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "async_manual_reset_event.h"
+#include "concepts.h"
+
+#include <atomic>
+#include <exception>
+#include <utility>
+
+// async_scope owns fire-and-forget work without detaching it.
+//
+// scope.spawn(ex, t) starts the awaitable t right away, on the executor ex,
+// with no awaiter needed: spawn wraps t in a small coroutine that awaits
+// ex.schedule() and then t, and that wrapper's frame is the only allocation
+// spawn makes. The wrapper's frame is freed as soon as t completes.
+// If the wrapper can't be made (allocating its frame, or moving ex or t into
+// it, throws), spawn rethrows and the scope doesn't wait for the work.
+//
+// The scope counts its outstanding work in one atomic; co_await scope.join()
+// completes (on the thread that finished the last piece of work) once all of it
+// is done, and then rethrows the first exception any of it threw.
+// A scope must be joined, once, before it is destroyed, and nothing may be
+// spawned into it after join() completes.
+
+class async_scope {
+    class join_awaitable;
+public:
+    async_scope() noexcept = default;
+
+    async_scope(const async_scope&) = delete;
+    async_scope& operator=(const async_scope&) = delete;
+
+    template<Executor E, class Work>
+    void spawn(E ex, Work work) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        try {
+            spawned_on(this, std::move(ex), std::move(work));
+        } catch (...) {
+            work_finished();
+            throw;
+        }
+    }
+
+    // Starts the work inline, on this thread, up to its first suspension.
+    template<class Work>
+    void spawn(Work work) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        try {
+            spawned_inline(this, std::move(work));
+        } catch (...) {
+            work_finished();
+            throw;
+        }
+    }
+
+    join_awaitable join() noexcept;
+
+private:
+    struct spawned_task {
+        struct promise_type {
+            spawned_task get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    template<class E, class Work>
+    static spawned_task spawned_on(async_scope *scope, E ex, Work work) {
+        try {
+            co_await ex.schedule();
+            co_await std::move(work);
+        } catch (...) {
+            scope->record_error(std::current_exception());
+        }
+        scope->work_finished();
+    }
+
+    template<class Work>
+    static spawned_task spawned_inline(async_scope *scope, Work work) {
+        try {
+            co_await std::move(work);
+        } catch (...) {
+            scope->record_error(std::current_exception());
+        }
+        scope->work_finished();
+    }
+
+    void record_error(std::exception_ptr e) noexcept {
+        if (!hasError_.exchange(true, std::memory_order_relaxed)) {
+            error_ = std::move(e);
+        }
+    }
+
+    void work_finished() noexcept {
+        if (count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            joined_.set();
+        }
+    }
+
+    class join_awaitable {
+    public:
+        explicit join_awaitable(async_scope *scope) noexcept :
+            scope_(scope),
+            inner_(scope->joined_.operator co_await())
+        {}
+
+        bool await_ready() noexcept {
+            // The count starts at 1, on behalf of the joiner.
+            scope_->work_finished();
+            return inner_.await_ready();
+        }
+
+        bool await_suspend(std::coroutine_handle<void> h) noexcept {
+            return inner_.await_suspend(h);
+        }
+
+        void await_resume() {
+            if (scope_->error_) {
+                std::rethrow_exception(scope_->error_);
+            }
+        }
+
+    private:
+        async_scope *scope_;
+        decltype(std::declval<async_manual_reset_event&>().operator co_await()) inner_;
+    };
+
+    std::atomic<size_t> count_{1};
+    std::atomic<bool> hasError_{false};
+    std::exception_ptr error_;
+    async_manual_reset_event joined_;
+};
+
+inline auto async_scope::join() noexcept -> join_awaitable
+{
+    return join_awaitable(this);
+}
+
+#endif // INCLUDED_CORO_ASYNC_SCOPE_H
@@ -0,0 +1,156 @@
+#ifndef INCLUDED_CORO_ASYNC_SEMAPHORE_H
+#define INCLUDED_CORO_ASYNC_SEMAPHORE_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+// async_semaphore is a counting semaphore whose acquire(n) is awaitable.
+//
+// Waiters queue up in FIFO order, as intrusive nodes living in the awaiting
+// coroutines' frames, so acquiring never allocates. A waiter at the head
+// of the queue holds back everyone behind it, even those asking for fewer
+// permits; that is what makes it fair.
+//
+// The uncontended paths are a single compare-and-swap on one atomic word,
+// whose top bit says "somebody is queued". While that bit is set, both
+// acquire and release go through the mutex, so nobody can barge past the queue.
+// release() resumes the waiters it satisfies inline, on the releasing thread,
+// after dropping the mutex.
+
+class async_semaphore {
+    class acquire_awaitable;
+public:
+    explicit async_semaphore(size_t permits) noexcept : state_(permits) {}
+
+    async_semaphore(const async_semaphore&) = delete;
+    async_semaphore& operator=(const async_semaphore&) = delete;
+
+    acquire_awaitable acquire(size_t n = 1) noexcept;
+
+    bool try_acquire(size_t n = 1) noexcept {
+        size_t old = state_.load(std::memory_order_relaxed);
+        while ((old & waitersBit) == 0 && old >= n) {
+            if (state_.compare_exchange_weak(old, old - n, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void release(size_t n = 1) {
+        size_t old = state_.load(std::memory_order_relaxed);
+        while ((old & waitersBit) == 0) {
+            if (state_.compare_exchange_weak(old, old + n, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        release_slow(n);
+    }
+
+    // The number of permits not currently held, ignoring anyone queued.
+    size_t available() const noexcept {
+        return state_.load(std::memory_order_relaxed) & ~waitersBit;
+    }
+
+private:
+    static constexpr size_t waitersBit = ~(~size_t(0) >> 1);
+
+    class acquire_awaitable {
+    public:
+        explicit acquire_awaitable(async_semaphore *sem, size_t n) noexcept : sem_(sem), n_(n) {}
+
+        bool await_ready() noexcept {
+            return sem_->try_acquire(n_);
+        }
+
+        bool await_suspend(std::coroutine_handle<void> h) {
+            coro_ = h;
+            return sem_->acquire_slow(this);
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        friend class async_semaphore;
+        async_semaphore *sem_;
+        size_t n_;
+        acquire_awaitable *next_ = nullptr;
+        std::coroutine_handle<void> coro_;
+    };
+
+    // Returns true if the caller was queued (and should stay suspended),
+    // false if it got its permits after all.
+    bool acquire_slow(acquire_awaitable *w) {
+        std::lock_guard<std::mutex> lock(mut_);
+        size_t old = state_.load(std::memory_order_relaxed);
+        while (true) {
+            if ((old & waitersBit) == 0 && old >= w->n_) {
+                if (state_.compare_exchange_weak(old, old - w->n_, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return false;
+                }
+            } else if (state_.compare_exchange_weak(old, old | waitersBit, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        if (tail_ != nullptr) {
+            tail_->next_ = w;
+        } else {
+            head_ = w;
+        }
+        tail_ = w;
+        return true;
+    }
+
+    void release_slow(size_t n) {
+        acquire_awaitable *ready = nullptr;
+        acquire_awaitable **readyTail = &ready;
+        if (true) {
+            std::lock_guard<std::mutex> lock(mut_);
+            // With the waiters bit set, the word only changes under mut_.
+            size_t permits = (state_.load(std::memory_order_relaxed) & ~waitersBit) + n;
+            while (head_ != nullptr && head_->n_ <= permits) {
+                permits -= head_->n_;
+                *readyTail = head_;
+                readyTail = &head_->next_;
+                head_ = head_->next_;
+            }
+            *readyTail = nullptr;
+            if (head_ == nullptr) {
+                tail_ = nullptr;
+                state_.store(permits, std::memory_order_release);
+            } else {
+                state_.store(permits | waitersBit, std::memory_order_release);
+            }
+        }
+        while (ready != nullptr) {
+            acquire_awaitable *next = ready->next_;
+            ready->coro_.resume();
+            ready = next;
+        }
+    }
+
+    std::atomic<size_t> state_;
+    std::mutex mut_;
+    acquire_awaitable *head_ = nullptr;
+    acquire_awaitable *tail_ = nullptr;
+};
+
+inline auto async_semaphore::acquire(size_t n) noexcept -> acquire_awaitable
+{
+    return acquire_awaitable(this, n);
+}
+
+#endif // INCLUDED_CORO_ASYNC_SEMAPHORE_H
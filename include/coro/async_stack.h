@@ -0,0 +1,176 @@
+#ifndef INCLUDED_CORO_ASYNC_STACK_H
+#define INCLUDED_CORO_ASYNC_STACK_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include <atomic>
+#include <execinfo.h>
+#include <mutex>
+#include <ostream>
+#include <stdlib.h>
+#include <type_traits>
+
+// Async stack traces for task<T>. Compile with -DCORO_ASYNC_STACK and every
+// task_promise becomes an async_stack_frame: each co_await in a task records
+// its return address (one relaxed store, plus a call that can't be inlined),
+// and awaiting a task links the child's frame to its parent's, with release
+// stores so that a dump on another thread sees fully constructed frames.
+// dump_async_stack(h) prints the chain from h's frame up to the root;
+// dump_async_roots() prints every live chain, innermost frame first.
+//
+// A root is a task awaited by something other than a task (sync_wait,
+// async_scope, ...). Registering and unregistering roots takes a mutex, and
+// so does dumping them. A finishing frame unlinks itself from its parent and
+// then, behind a fence, checks whether a dump is in progress; if one is, it
+// waits for the dump to let go of the mutex before it goes away, so a dump
+// never walks into a freed frame. Addresses are printed with
+// backtrace_symbols; GCC keeps coroutine resume functions local, so feed
+// them to addr2line -Cfpe for names.
+//
+// The return address of a frame that is running while a dump walks it may
+// be stale; dump chains that are stuck.
+
+class async_stack_frame {
+public:
+    async_stack_frame() noexcept = default;
+    async_stack_frame(const async_stack_frame&) = delete;
+    async_stack_frame& operator=(const async_stack_frame&) = delete;
+
+    ~async_stack_frame() {
+        on_finish();
+    }
+
+    // Where this frame's coroutine is (or was last) suspended.
+    void *suspended_at() const noexcept { return suspendedAt_.load(std::memory_order_relaxed); }
+    async_stack_frame *parent() const noexcept { return parent_.load(std::memory_order_acquire); }
+    async_stack_frame *child() const noexcept { return child_.load(std::memory_order_acquire); }
+
+    [[gnu::always_inline]] void on_await(void *returnAddress) noexcept {
+        suspendedAt_.store(returnAddress, std::memory_order_relaxed);
+    }
+
+    // This frame is about to be resumed by an awaiter, whose frame is
+    // parent if the awaiter is a task, or null otherwise.
+    void on_awaited(async_stack_frame *parent) noexcept {
+        parent_.store(parent, std::memory_order_release);
+        if (parent != nullptr) {
+            parent->child_.store(this, std::memory_order_release);
+        } else {
+            register_root();
+        }
+    }
+
+    void on_finish() noexcept {
+        if (async_stack_frame *p = parent_.exchange(nullptr, std::memory_order_relaxed)) {
+            async_stack_frame *self = this;
+            p->child_.compare_exchange_strong(self, nullptr, std::memory_order_relaxed);
+            // Pairs with the fence in dump_roots: either the dump can no longer
+            // reach this frame, or we see it running and wait it out. The
+            // acquire orders our destruction after any dump that has ended.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (registry().dumping_.load(std::memory_order_acquire) != 0) {
+                std::lock_guard<std::mutex> lock(registry().mut_);
+            }
+        } else if (isRoot_) {
+            unregister_root();
+        }
+    }
+
+    static void dump(const async_stack_frame *frame, std::ostream& os) {
+        int depth = 0;
+        for (; frame != nullptr; frame = frame->parent(), ++depth) {
+            void *addr = frame->suspended_at();
+            os << "  #" << depth << " ";
+            if (char **names = (addr != nullptr) ? backtrace_symbols(&addr, 1) : nullptr) {
+                os << names[0];
+                free(names);
+            } else {
+                os << "(not yet suspended) frame " << static_cast<const void*>(frame);
+            }
+            os << "\n";
+        }
+    }
+
+    static void dump_roots(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(registry().mut_);
+        registry().dumping_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int n = 0;
+        for (async_stack_frame *root = registry().head_; root != nullptr; root = root->nextRoot_, ++n) {
+            const async_stack_frame *innermost = root;
+            while (const async_stack_frame *c = innermost->child()) {
+                innermost = c;
+            }
+            os << "async stack " << n << ":\n";
+            dump(innermost, os);
+        }
+        registry().dumping_.fetch_sub(1, std::memory_order_release);
+    }
+
+private:
+    struct root_registry {
+        std::mutex mut_;
+        async_stack_frame *head_ = nullptr;
+        std::atomic<int> dumping_{0};
+    };
+
+    static root_registry& registry() {
+        static root_registry r;
+        return r;
+    }
+
+    void register_root() {
+        std::lock_guard<std::mutex> lock(registry().mut_);
+        if (!isRoot_) {
+            isRoot_ = true;
+            prevRoot_ = nullptr;
+            nextRoot_ = registry().head_;
+            if (nextRoot_ != nullptr) {
+                nextRoot_->prevRoot_ = this;
+            }
+            registry().head_ = this;
+        }
+    }
+
+    void unregister_root() {
+        std::lock_guard<std::mutex> lock(registry().mut_);
+        if (isRoot_) {
+            isRoot_ = false;
+            (prevRoot_ != nullptr ? prevRoot_->nextRoot_ : registry().head_) = nextRoot_;
+            if (nextRoot_ != nullptr) {
+                nextRoot_->prevRoot_ = prevRoot_;
+            }
+        }
+    }
+
+    std::atomic<void*> suspendedAt_{nullptr};
+    std::atomic<async_stack_frame*> parent_{nullptr};
+    std::atomic<async_stack_frame*> child_{nullptr};
+    async_stack_frame *prevRoot_ = nullptr;
+    async_stack_frame *nextRoot_ = nullptr;
+    bool isRoot_ = false;
+};
+
+template<class P>
+void dump_async_stack(std::coroutine_handle<P> h, std::ostream& os)
+{
+    static_assert(std::is_base_of_v<async_stack_frame, P>, "dump_async_stack needs a task compiled with -DCORO_ASYNC_STACK");
+    async_stack_frame::dump(&h.promise(), os);
+}
+
+inline void dump_async_roots(std::ostream& os)
+{
+    async_stack_frame::dump_roots(os);
+}
+
+#endif // INCLUDED_CORO_ASYNC_STACK_H
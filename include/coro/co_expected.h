@@ -0,0 +1,279 @@
+#ifndef INCLUDED_CORO_CO_EXPECTED_H
+#define INCLUDED_CORO_CO_EXPECTED_H
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+// co_expected<T, E> holds either a T or an error of type E. In a coroutine
+// returning co_expected, co_await on a co_expected yields its value, or
+// short-circuits: the enclosing coroutine immediately returns the error,
+// converted to its own E. This is co_optional's early return, but with a
+// reason attached, and without exceptions: an exception escaping a
+// co_expected coroutine terminates.
+//
+// Awaiting an lvalue refers to its value in place, and awaiting an rvalue
+// moves from it; neither copies. A co_expected coroutine can await nothing
+// else: anything that really suspended would leave it with no result.
+//
+// Unlike co_optional, the coroutine never destroys itself. Its return object
+// owns the frame, and destroys it as soon as the result has been moved out,
+// in the caller. So frames always die in the reverse order of their creation,
+// and they come from a small per-thread LIFO arena rather than the heap: the
+// heap is touched only when the arena overflows. (No frame is promised to be
+// elided; test/codegen/co_expected.cpp checks only that hot paths stay off
+// the heap.)
+//
+// The coroutine starts suspended, and converting its return object to
+// co_expected is what runs it. That relies on the conversion being delayed
+// until the ramp has reached initial_suspend and returned to its caller, as
+// GCC and Clang 17+ do (CWG2563). MSVC and older Clangs convert eagerly,
+// inside the ramp, where resuming or destroying the frame is undefined;
+// they're rejected below rather than miscompiled.
+
+#if defined(__clang__)
+#if defined(__apple_build_version__) ? (__clang_major__ < 16) : (__clang_major__ < 17)
+#error "co_expected needs the return object converted after initial_suspend (CWG2563): use Clang 17 or later"
+#endif
+#elif defined(_MSC_VER)
+#error "co_expected needs the return object converted after initial_suspend (CWG2563), which MSVC doesn't do"
+#endif
+
+template<class E>
+class unexpected {
+public:
+    template<class U = E, std::enable_if_t<std::is_constructible_v<E, U&&>, int> = 0>
+    constexpr explicit unexpected(U&& e) : error_(static_cast<U&&>(e)) {}
+
+    constexpr const E& error() const& noexcept { return error_; }
+    constexpr E& error() & noexcept { return error_; }
+    constexpr E&& error() && noexcept { return std::move(error_); }
+
+private:
+    E error_;
+};
+
+template<class E>
+unexpected(E) -> unexpected<E>;
+
+template<class E>
+class bad_expected_access : public std::exception {
+public:
+    explicit bad_expected_access(E e) : error_(std::move(e)) {}
+    const char *what() const noexcept override { return "bad_expected_access"; }
+    const E& error() const noexcept { return error_; }
+
+private:
+    E error_;
+};
+
+template<class T, class E> class co_expected;
+
+namespace co_expected_detail {
+
+template<class A> inline constexpr bool is_co_expected_v = false;
+template<class T, class E> inline constexpr bool is_co_expected_v<co_expected<T, E>> = true;
+
+// co_expected frames always die in the reverse order of their creation,
+// so a bump allocator is all they need.
+class frame_arena {
+public:
+    static constexpr size_t capacity = 16384;
+
+    static void *allocate(size_t n) {
+        frame_arena& a = local();
+        size_t size = round_up(n);
+        if (capacity - a.top_ >= size) {
+            void *p = a.buffer_ + a.top_;
+            a.top_ += size;
+            return p;
+        }
+        return allocate_slow(n);
+    }
+
+    static void deallocate(void *p, size_t n) noexcept {
+        frame_arena& a = local();
+        if (p >= a.buffer_ && p < a.buffer_ + capacity) {
+            a.top_ -= round_up(n);
+        } else {
+            deallocate_slow(p);
+        }
+    }
+
+private:
+    static constexpr size_t round_up(size_t n) {
+        return (n + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    // Kept out of line, so that heap calls stay off the inlined fast path.
+    [[gnu::noinline]] static void *allocate_slow(size_t n) { return ::operator new(n); }
+    [[gnu::noinline]] static void deallocate_slow(void *p) noexcept { ::operator delete(p); }
+
+    static frame_arena& local() noexcept {
+        static thread_local frame_arena a;
+        return a;
+    }
+
+    alignas(std::max_align_t) char buffer_[capacity];
+    size_t top_ = 0;
+};
+
+} // namespace co_expected_detail
+
+template<class T, class E>
+class co_expected {
+    template<class U, class F> friend class co_expected;
+    template<class Ref> class expected_awaitable;
+
+    class return_object;
+
+    struct expected_promise {
+        std::optional<co_expected> result_;
+
+        using is_expected_promise = void;
+        using error_type = E;
+        using handle_t = std::coroutine_handle<expected_promise>;
+
+        static void *operator new(size_t n) { return co_expected_detail::frame_arena::allocate(n); }
+        static void operator delete(void *p, size_t n) noexcept { co_expected_detail::frame_arena::deallocate(p, n); }
+
+        return_object get_return_object() noexcept { return return_object(handle_t::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        template<class A>
+        A&& await_transform(A&& a) noexcept {
+            static_assert(co_expected_detail::is_co_expected_v<std::remove_cvref_t<A>>,
+                "a co_expected coroutine can co_await only a co_expected");
+            return static_cast<A&&>(a);
+        }
+
+        template<class U = T>
+        void return_value(U&& value) { result_.emplace(static_cast<U&&>(value)); }
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    // Owns the frame. Converting it to co_expected runs the body, which ends
+    // either at its co_return or at a short-circuiting co_await, then takes
+    // the result and frees the frame.
+    class return_object {
+    public:
+        explicit return_object(typename expected_promise::handle_t h) noexcept : coro_(h) {}
+        return_object(return_object&& rhs) noexcept : coro_(std::exchange(rhs.coro_, nullptr)) {}
+        ~return_object() {
+            if (coro_) {
+                coro_.destroy();
+            }
+        }
+
+        operator co_expected() {
+            coro_.resume();
+            co_expected result = *std::move(coro_.promise().result_);
+            std::exchange(coro_, nullptr).destroy();
+            return result;
+        }
+
+    private:
+        typename expected_promise::handle_t coro_;
+    };
+
+    // Ref is co_expected& or co_expected&&.
+    template<class Ref>
+    class expected_awaitable {
+    public:
+        explicit expected_awaitable(co_expected *e) noexcept : e_(e) {}
+
+        bool await_ready() noexcept { return e_->has_value(); }
+
+        decltype(auto) await_resume() noexcept {
+            return *static_cast<Ref>(*e_);
+        }
+
+        template<class P, class = typename P::is_expected_promise>
+        void await_suspend(std::coroutine_handle<P> h) {
+            h.promise().result_.emplace(unexpected<typename P::error_type>(static_cast<Ref>(*e_).error()));
+        }
+
+    private:
+        co_expected *e_;
+    };
+
+public:
+    using value_type = T;
+    using error_type = E;
+    using promise_type = expected_promise;
+
+    friend expected_awaitable<co_expected&> operator co_await(co_expected& e) noexcept {
+        return expected_awaitable<co_expected&>(&e);
+    }
+    friend expected_awaitable<co_expected&&> operator co_await(co_expected&& e) noexcept {
+        return expected_awaitable<co_expected&&>(&e);
+    }
+
+    template<class U = T, std::enable_if_t<
+        !std::is_same_v<std::decay_t<U>, co_expected> &&
+        std::is_constructible_v<T, U&&> && std::is_convertible_v<U&&, T>
+        , int> = 0>
+    constexpr co_expected(U&& u) : v_(std::in_place_index<0>, static_cast<U&&>(u)) {}
+
+    template<class G, std::enable_if_t<std::is_constructible_v<E, const G&>, int> = 0>
+    constexpr co_expected(const unexpected<G>& u) : v_(std::in_place_index<1>, u.error()) {}
+
+    template<class G, std::enable_if_t<std::is_constructible_v<E, G&&>, int> = 0>
+    constexpr co_expected(unexpected<G>&& u) : v_(std::in_place_index<1>, std::move(u).error()) {}
+
+    template<class... Us, std::enable_if_t<std::is_constructible_v<T, Us&&...>, int> = 0>
+    constexpr explicit co_expected(std::in_place_t, Us&&... us) : v_(std::in_place_index<0>, static_cast<Us&&>(us)...) {}
+
+    constexpr co_expected(const co_expected&) = default;
+    constexpr co_expected(co_expected&&) = default;
+    constexpr co_expected& operator=(const co_expected&) = default;
+    constexpr co_expected& operator=(co_expected&&) = default;
+
+    constexpr explicit operator bool() const noexcept { return v_.index() == 0; }
+    constexpr bool has_value() const noexcept { return v_.index() == 0; }
+
+    constexpr const T *operator->() const { return std::get_if<0>(&v_); }
+    constexpr T *operator->() { return std::get_if<0>(&v_); }
+    constexpr const T& operator*() const& { return *std::get_if<0>(&v_); }
+    constexpr T& operator*() & { return *std::get_if<0>(&v_); }
+    constexpr T&& operator*() && { return std::move(*std::get_if<0>(&v_)); }
+
+    constexpr T& value() & { check(); return **this; }
+    constexpr const T& value() const& { check(); return **this; }
+    constexpr T&& value() && { check(); return *std::move(*this); }
+
+    constexpr const E& error() const& { return *std::get_if<1>(&v_); }
+    constexpr E& error() & { return *std::get_if<1>(&v_); }
+    constexpr E&& error() && { return std::move(*std::get_if<1>(&v_)); }
+
+    template<class U> constexpr T value_or(U&& default_value) const& {
+        return has_value() ? **this : static_cast<T>(static_cast<U&&>(default_value));
+    }
+    template<class U> constexpr T value_or(U&& default_value) && {
+        return has_value() ? *std::move(*this) : static_cast<T>(static_cast<U&&>(default_value));
+    }
+
+    friend constexpr bool operator==(const co_expected& a, const co_expected& b) {
+        return a.v_ == b.v_;
+    }
+    friend constexpr bool operator!=(const co_expected& a, const co_expected& b) {
+        return !(a == b);
+    }
+
+private:
+    constexpr void check() const {
+        if (!has_value()) {
+            throw bad_expected_access<E>(error());
+        }
+    }
+
+    std::variant<T, E> v_;
+};
+
+#endif // INCLUDED_CORO_CO_EXPECTED_H
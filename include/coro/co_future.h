@@ -17,93 +17,363 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
-#include <functional>
+#include "concepts.h"
+
+#include <atomic>
+#include <exception>
 #include <future>
+#include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
 
+// co_future<T> is a one-shot, move-only future that models Awaitable.
+// Get one either from a co_promise<T>, or by writing a coroutine that
+// returns co_future<T>; in the latter case the shared state lives in the
+// coroutine frame itself, and there is no separate allocation.
+//
+// The shared state's single atomic word is nullptr (pending), a pointer to
+// the registered continuation, or a pointer to the state itself (ready).
+// Whichever of the producer and the consumer gets there second wins the
+// race and runs the continuation: the awaiting coroutine is resumed directly
+// by the producer, on the producer's thread, with no threads or condition
+// variables involved. get() and wait() block the calling thread; don't mix
+// them with co_await on the same future.
+//
+// f.then(ex, w) returns a co_future for the result of w() (or of
+// w(std::move(f)), if w takes the future), which runs on executor ex once f
+// is ready. f.then(w) runs w inline on whichever thread completes f, which is
+// the cheap choice when w is short. Each link in a chain of then()s costs
+// one coroutine frame, and no threads.
+
+// inline_executor models Executor. Its schedule() doesn't suspend at all.
+struct inline_executor {
+    std::suspend_never schedule() const noexcept { return {}; }
+};
+
+template<class T> class co_future;
+template<class T> class co_promise;
+
 namespace co_future_detail {
 
+struct continuation {
+    // If fire_ is null, the continuation is simply to resume coro_.
+    void (*fire_)(continuation *) = nullptr;
+    std::coroutine_handle<void> coro_;
+};
+
+template<class T>
+struct result_storage {
+    result_storage() {}
+    ~result_storage() {
+        if (hasValue_) {
+            value_.~T();
+        }
+    }
+
+    template<class... Args>
+    void emplace(Args&&... args) {
+        ::new ((void*)std::addressof(value_)) T(std::forward<Args>(args)...);
+        hasValue_ = true;
+    }
+
+    T take() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return std::move(value_);
+    }
+
+    union { T value_; };
+    bool hasValue_ = false;
+    std::exception_ptr error_;
+};
+
+template<>
+struct result_storage<void> {
+    void emplace() {}
+
+    void take() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    std::exception_ptr error_;
+};
+
+template<class T>
+class shared_state : public result_storage<T> {
+public:
+    explicit shared_state(int refs, void (*destroy)(shared_state *)) noexcept :
+        refs_(refs), destroy_(destroy) {}
+
+    shared_state(const shared_state&) = delete;
+    shared_state& operator=(const shared_state&) = delete;
+
+    bool is_ready() const noexcept {
+        return state_.load(std::memory_order_acquire) == this;
+    }
+
+    // Returns false, without registering c, if the result is already available.
+    bool set_continuation(continuation *c) noexcept {
+        void *expected = nullptr;
+        return state_.compare_exchange_strong(expected, c, std::memory_order_release, std::memory_order_acquire);
+    }
+
+    // Publishes the result, and returns the continuation (if any) that the
+    // caller is now responsible for running.
+    continuation *complete() noexcept {
+        void *old = state_.exchange(this, std::memory_order_acq_rel);
+        if (old == nullptr) {
+            state_.notify_all();
+        }
+        return static_cast<continuation*>(old);
+    }
+
+    void wait() const noexcept {
+        void *s = state_.load(std::memory_order_acquire);
+        while (s != this) {
+            state_.wait(s, std::memory_order_acquire);
+            s = state_.load(std::memory_order_acquire);
+        }
+    }
+
+    void add_ref() noexcept {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            destroy_(this);
+        }
+    }
+
+    static void run(continuation *c) {
+        if (c == nullptr) {
+            return;
+        } else if (c->fire_ != nullptr) {
+            c->fire_(c);
+        } else {
+            c->coro_.resume();
+        }
+    }
+
+private:
+    std::atomic<void*> state_{nullptr};
+    std::atomic<int> refs_;
+    void (*destroy_)(shared_state *);
+};
+
 template<class T, class CRTP>
 struct return_value_or_void {
     template<class U>
     void return_value(U&& value) {
-        static_cast<CRTP*>(this)->promise_.set_value(std::forward<U>(value));
+        static_cast<CRTP*>(this)->emplace(std::forward<U>(value));
     }
 };
 
 template<class CRTP>
 struct return_value_or_void<void, CRTP> {
-    void return_void() {
-        static_cast<CRTP*>(this)->promise_.set_value();
-    }
+    void return_void() {}
 };
 
+// The promise of a coroutine returning co_future<T> is the shared state;
+// the frame is destroyed when both the coroutine and the future are done with it.
 template<class T>
-struct promise_type : public co_future_detail::return_value_or_void<T, promise_type<T>> {
-    private:
-        friend class co_future_detail::return_value_or_void<T, promise_type<T>>;
-        std::promise<T> promise_;
-    public:
-
-        auto get_return_object() { return promise_.get_future(); }
-        auto initial_suspend() { return std::suspend_never{}; }
-        auto final_suspend() { return std::suspend_never{}; }
-
-        void set_exception(std::exception_ptr ex) {
-            promise_.set_exception(std::move(ex));
-        }
+struct promise_type : public shared_state<T>, public return_value_or_void<T, promise_type<T>> {
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    promise_type() noexcept : shared_state<T>(2, [](shared_state<T> *s) {
+        handle_t::from_promise(*static_cast<promise_type*>(s)).destroy();
+    }) {}
 
-        void unhandled_exception() {}
+    struct final_awaiter {
+        bool await_ready() noexcept { return false; }
+        std::coroutine_handle<void> await_suspend(handle_t h) noexcept {
+            promise_type& p = h.promise();
+            continuation *c = p.complete();
+            p.release();  // may destroy the frame
+            if (c == nullptr) {
+                return std::noop_coroutine();
+            } else if (c->fire_ != nullptr) {
+                c->fire_(c);
+                return std::noop_coroutine();
+            }
+            return c->coro_;
+        }
+        void await_resume() noexcept {}
     };
 
+    co_future<T> get_return_object() noexcept { return co_future<T>(this); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    final_awaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() noexcept {
+        this->error_ = std::current_exception();
+    }
+};
+
 } // namespace co_future_detail
 
 template<class T>
-struct co_future : public std::future<T> {
-    using std::future<T>::future;
-    using std::future<T>::get;
-    using std::future<T>::valid;
-    using std::future<T>::wait;
-    using std::future<T>::wait_for;
-
+class co_future {
+    using state_t = co_future_detail::shared_state<T>;
+public:
     using promise_type = co_future_detail::promise_type<T>;
 
-    co_future(std::future<T>&& f) noexcept : std::future<T>(std::move(f)) {}
+    co_future() noexcept = default;
+    co_future(co_future&& rhs) noexcept : state_(std::exchange(rhs.state_, nullptr)) {}
+    co_future& operator=(co_future rhs) noexcept {
+        std::swap(state_, rhs.state_);
+        return *this;
+    }
+    ~co_future() {
+        if (state_ != nullptr) {
+            state_->release();
+        }
+    }
+
+    bool valid() const noexcept { return state_ != nullptr; }
+    bool is_ready() const noexcept { return state_->is_ready(); }
+    void wait() const noexcept { state_->wait(); }
 
-    bool is_ready() const {
-        return wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    // Blocks until the result is available, then returns (or throws) it.
+    // Like std::future::get, this leaves the future invalid.
+    T get() {
+        state_->wait();
+        co_future self = std::move(*this);
+        return self.state_->take();
     }
 
     template<class Work>
-    auto then(Work&& w) -> co_future<decltype(w())> {
-        return { std::async([fut = std::move(*this), w = std::forward<Work>(w)]() mutable {
-            fut.wait();
-            return w();
-        })};
+    auto then(Work w) -> co_future<decltype(w())> {
+        return then_impl(std::move(*this), inline_executor(), std::move(w));
     }
 
     template<class Work>
-    auto then(Work&& w) -> co_future<decltype(w(std::move(*this)))> {
-        return { std::async([fut = std::move(*this), w = std::forward<Work>(w)]() mutable {
-            return w(std::move(fut));
-        })};
+    auto then(Work w) -> co_future<decltype(w(std::move(*this)))> {
+        return then_with_future_impl(std::move(*this), inline_executor(), std::move(w));
     }
 
-    void await_suspend(std::coroutine_handle<void> ch) {
-        then([ch, this](auto fut) mutable {
-            *this = std::move(fut);
-            ch.resume();
-        });
+    template<Executor E, class Work>
+    auto then(E ex, Work w) -> co_future<decltype(w())> {
+        return then_impl(std::move(*this), std::move(ex), std::move(w));
     }
 
-    bool await_ready() {
-        return is_ready();
+    template<Executor E, class Work>
+    auto then(E ex, Work w) -> co_future<decltype(w(std::move(*this)))> {
+        return then_with_future_impl(std::move(*this), std::move(ex), std::move(w));
     }
 
-    auto await_resume() {
-        return get();
+    bool await_ready() const noexcept {
+        return state_->is_ready();
+    }
+
+    bool await_suspend(std::coroutine_handle<void> h) noexcept {
+        waiter_.coro_ = h;
+        return state_->set_continuation(&waiter_);
+    }
+
+    T await_resume() {
+        co_future self = std::move(*this);
+        return self.state_->take();
+    }
+
+private:
+    friend class co_promise<T>;
+    friend struct co_future_detail::promise_type<T>;
+
+    explicit co_future(state_t *s) noexcept : state_(s) {}
+
+    template<class E, class Work>
+    static auto then_impl(co_future self, E ex, Work w) -> co_future<decltype(w())> {
+        co_await self.ready();
+        co_await ex.schedule();
+        co_return w();
     }
+
+    template<class E, class Work>
+    static auto then_with_future_impl(co_future self, E ex, Work w) -> co_future<decltype(w(std::move(self)))> {
+        co_await self.ready();
+        co_await ex.schedule();
+        co_return w(std::move(self));
+    }
+
+    // Awaiting ready() waits for the result without consuming it.
+    struct ready_awaitable {
+        co_future *self_;
+        bool await_ready() const noexcept { return self_->await_ready(); }
+        bool await_suspend(std::coroutine_handle<void> h) noexcept { return self_->await_suspend(h); }
+        void await_resume() noexcept {}
+    };
+    ready_awaitable ready() noexcept { return ready_awaitable{this}; }
+
+    state_t *state_ = nullptr;
+    co_future_detail::continuation waiter_;
+};
+
+template<class T>
+class co_promise {
+    using state_t = co_future_detail::shared_state<T>;
+public:
+    co_promise() : state_(new state_t(1, [](state_t *s) { delete s; })) {}
+    co_promise(co_promise&& rhs) noexcept :
+        state_(std::exchange(rhs.state_, nullptr)),
+        retrieved_(rhs.retrieved_),
+        satisfied_(rhs.satisfied_)
+    {}
+    co_promise& operator=(co_promise rhs) noexcept {
+        std::swap(state_, rhs.state_);
+        std::swap(retrieved_, rhs.retrieved_);
+        std::swap(satisfied_, rhs.satisfied_);
+        return *this;
+    }
+    ~co_promise() {
+        if (state_ != nullptr) {
+            if (!satisfied_ && retrieved_) {
+                set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+            state_->release();
+        }
+    }
+
+    co_future<T> get_future() {
+        if (retrieved_) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        retrieved_ = true;
+        state_->add_ref();
+        return co_future<T>(state_);
+    }
+
+    // Resumes the awaiting coroutine, if any, before returning. If T's
+    // constructor throws, the promise stays unsatisfied.
+    template<class... Args>
+    void set_value(Args&&... args) {
+        check_unsatisfied();
+        state_->emplace(std::forward<Args>(args)...);
+        satisfied_ = true;
+        state_t::run(state_->complete());
+    }
+
+    void set_exception(std::exception_ptr ex) {
+        check_unsatisfied();
+        state_->error_ = std::move(ex);
+        satisfied_ = true;
+        state_t::run(state_->complete());
+    }
+
+private:
+    void check_unsatisfied() const {
+        if (satisfied_) {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+    }
+
+    state_t *state_;
+    bool retrieved_ = false;
+    bool satisfied_ = false;
 };
 
 #endif // INCLUDED_CORO_CO_FUTURE_H
@@ -16,6 +16,10 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
+#ifdef CORO_FRAME_PROFILE
+#include "frame_profile.h"
+#endif
+
 #include <optional>
 #include <utility>
 
@@ -54,7 +58,11 @@ template<class T>
 class co_optional {
     std::optional<T> o_;
 
-    struct maybe_promise {
+    struct maybe_promise
+#ifdef CORO_FRAME_PROFILE
+        : frame_profiled<maybe_promise>
+#endif
+    {
         return_object_holder<co_optional> *data;
 
         using is_maybe_promise = void;
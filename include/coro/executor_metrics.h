@@ -0,0 +1,137 @@
+#ifndef INCLUDED_CORO_EXECUTOR_METRICS_H
+#define INCLUDED_CORO_EXECUTOR_METRICS_H
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// executor_metrics is a snapshot of an execution context's counters, as
+// returned by its .metrics() method. Counters only ever go up; gauges
+// (live threads, queue depth) are as of the snapshot. A context's counters
+// live in executor_metrics_shard objects, one per thread that writes them
+// (or per lock that its writers hold), so that counting never makes two
+// threads contend for a cache line. A snapshot sums the shards without
+// stopping anyone, so it's only approximately consistent.
+//
+// write_text() produces the Prometheus text exposition format.
+
+struct latency_histogram {
+    // bucket_[k] counts latencies of at least 2^(k-1) and less than 2^k ns.
+    static constexpr int buckets = 48;
+
+    uint64_t count_ = 0;
+    uint64_t sumNs_ = 0;
+    uint64_t bucket_[buckets] = {};
+
+    // An upper bound on the p-th quantile (0 <= p <= 1), in nanoseconds.
+    uint64_t quantile_ns(double p) const noexcept {
+        uint64_t target = uint64_t(p * count_);
+        uint64_t seen = 0;
+        for (int k = 0; k < buckets; ++k) {
+            seen += bucket_[k];
+            if (seen > target || seen == count_) {
+                return uint64_t(1) << k;
+            }
+        }
+        return uint64_t(1) << (buckets - 1);
+    }
+};
+
+struct executor_metrics {
+    uint64_t scheduled_ = 0;       // handles handed to the context
+    uint64_t resumed_ = 0;         // handles the context has resumed
+    uint64_t steals_ = 0;          // handles taken from another worker's queue
+    uint64_t wakeups_ = 0;         // parked threads woken for new work
+    uint64_t parks_ = 0;           // times a thread parked for lack of work
+    uint64_t parkedNs_ = 0;        // total time threads spent parked
+    uint64_t threadsStarted_ = 0;
+    uint64_t spawnFailures_ = 0;
+    size_t liveThreads_ = 0;
+    size_t queueDepth_ = 0;
+    latency_histogram latency_;    // from schedule() to resumption
+
+    void write_text(std::ostream& os, const std::string& prefix) const {
+        auto counter = [&](const char *name, uint64_t value) {
+            os << "# TYPE " << prefix << "_" << name << " counter\n";
+            os << prefix << "_" << name << " " << value << "\n";
+        };
+        auto gauge = [&](const char *name, uint64_t value) {
+            os << "# TYPE " << prefix << "_" << name << " gauge\n";
+            os << prefix << "_" << name << " " << value << "\n";
+        };
+        counter("scheduled_total", scheduled_);
+        counter("resumed_total", resumed_);
+        counter("steals_total", steals_);
+        counter("wakeups_total", wakeups_);
+        counter("parks_total", parks_);
+        os << "# TYPE " << prefix << "_parked_seconds_total counter\n";
+        os << prefix << "_parked_seconds_total " << parkedNs_ * 1e-9 << "\n";
+        counter("threads_started_total", threadsStarted_);
+        counter("spawn_failures_total", spawnFailures_);
+        gauge("live_threads", liveThreads_);
+        gauge("queue_depth", queueDepth_);
+
+        std::string h = prefix + "_schedule_latency_seconds";
+        os << "# TYPE " << h << " histogram\n";
+        // Every bucket, every time, so that scrapes can be compared.
+        uint64_t cumulative = 0;
+        for (int k = 0; k < latency_histogram::buckets; ++k) {
+            cumulative += latency_.bucket_[k];
+            os << h << "_bucket{le=\"" << double(uint64_t(1) << k) * 1e-9 << "\"} " << cumulative << "\n";
+        }
+        os << h << "_bucket{le=\"+Inf\"} " << latency_.count_ << "\n";
+        os << h << "_sum " << latency_.sumNs_ * 1e-9 << "\n";
+        os << h << "_count " << latency_.count_ << "\n";
+    }
+};
+
+class alignas(64) executor_metrics_shard {
+public:
+    // Only one thread at a time writes to a shard, so an increment
+    // is a relaxed load and store, not a locked read-modify-write.
+    static void bump(std::atomic<uint64_t>& c, uint64_t n = 1) noexcept {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void record_latency(std::chrono::steady_clock::duration d) noexcept {
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        int k = std::bit_width(ns);
+        bump(latency_[k < latency_histogram::buckets ? k : latency_histogram::buckets - 1]);
+        bump(latencyCount_);
+        bump(latencySumNs_, ns);
+    }
+
+    void add_to(executor_metrics& m) const noexcept {
+        m.scheduled_ += scheduled_.load(std::memory_order_relaxed);
+        m.resumed_ += resumed_.load(std::memory_order_relaxed);
+        m.steals_ += steals_.load(std::memory_order_relaxed);
+        m.wakeups_ += wakeups_.load(std::memory_order_relaxed);
+        m.parks_ += parks_.load(std::memory_order_relaxed);
+        m.parkedNs_ += parkedNs_.load(std::memory_order_relaxed);
+        m.threadsStarted_ += threadsStarted_.load(std::memory_order_relaxed);
+        m.spawnFailures_ += spawnFailures_.load(std::memory_order_relaxed);
+        m.latency_.count_ += latencyCount_.load(std::memory_order_relaxed);
+        m.latency_.sumNs_ += latencySumNs_.load(std::memory_order_relaxed);
+        for (int k = 0; k < latency_histogram::buckets; ++k) {
+            m.latency_.bucket_[k] += latency_[k].load(std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<uint64_t> scheduled_{0};
+    std::atomic<uint64_t> resumed_{0};
+    std::atomic<uint64_t> steals_{0};
+    std::atomic<uint64_t> wakeups_{0};
+    std::atomic<uint64_t> parks_{0};
+    std::atomic<uint64_t> parkedNs_{0};
+    std::atomic<uint64_t> threadsStarted_{0};
+    std::atomic<uint64_t> spawnFailures_{0};
+    std::atomic<uint64_t> latencyCount_{0};
+    std::atomic<uint64_t> latencySumNs_{0};
+    std::atomic<uint64_t> latency_[latency_histogram::buckets] = {};
+};
+
+#endif // INCLUDED_CORO_EXECUTOR_METRICS_H
@@ -0,0 +1,375 @@
+#ifndef INCLUDED_CORO_FORK_JOIN_H
+#define INCLUDED_CORO_FORK_JOIN_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "work_stealing_pool.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <utility>
+
+// fork_task<T> is a Cilk-style strict fork/join task for recursive parallel
+// algorithms on a work_stealing_pool. Inside a fork_task,
+//
+//     co_await fork_join::spawn(child, out);
+//
+// pushes the *parent's* continuation onto the current worker's deque and
+// starts running the child immediately on the same thread. If no other worker
+// steals the continuation, the child pops it back off when it completes and the
+// whole thing costs about as much as a function call; if a thief does steal it,
+// the parent carries on in parallel. The child's result is assigned to out.
+//
+//     co_await fork_join::sync();
+//
+// then waits for all the children spawned so far; out is only meaningful after it.
+// A fork_task must sync before it returns if it has spawned anything.
+//
+// Frames of fork_tasks created on a pool worker come from that worker's
+// fork_frame_stack, a bump allocator that frees in LIFO order, so spawning
+// doesn't touch the global heap. Exceptions escaping a fork_task terminate.
+//
+// Run a root task with co_await fork_join::run(pool, t), which resumes its
+// awaiter on a pool worker with the root's result.
+
+template<class T> class fork_task;
+
+// A per-thread arena for coroutine frames, freed in LIFO order. A frame freed
+// out of order (or by another thread, after its continuation was stolen) is only
+// marked as freed, and its space is reclaimed once everything above it is gone too.
+class fork_frame_stack {
+    struct alignas(std::max_align_t) header {
+        header *prev_;
+        fork_frame_stack *owner_;
+        std::atomic<bool> freed_;
+    };
+public:
+    static constexpr size_t capacity = 1 << 20;
+
+    static void *allocate(size_t n) {
+        if (fork_frame_stack *s = local()) {
+            if (void *p = s->try_push(n)) {
+                return p;
+            }
+        }
+        header *h = static_cast<header*>(::operator new(sizeof(header) + n));
+        h->owner_ = nullptr;
+        return h + 1;
+    }
+
+    static void deallocate(void *p) noexcept {
+        header *h = static_cast<header*>(p) - 1;
+        fork_frame_stack *owner = h->owner_;
+        if (owner == nullptr) {
+            ::operator delete(h);
+        } else if (owner == localStack_.get() && h == owner->top_) {
+            owner->top_ = h->prev_;
+            owner->used_ = reinterpret_cast<char*>(h) - owner->base_.get();
+            owner->reclaim();
+        } else {
+            h->freed_.store(true, std::memory_order_release);
+        }
+    }
+
+private:
+    // Only pool workers get an arena; frames created anywhere else go to the heap.
+    static fork_frame_stack *local() {
+        if (localStack_ == nullptr && work_stealing_pool::current_worker() != nullptr) {
+            localStack_ = std::make_unique<fork_frame_stack>();
+        }
+        return localStack_.get();
+    }
+
+    void *try_push(size_t n) {
+        reclaim();
+        size_t size = (sizeof(header) + n + alignof(header) - 1) & ~(alignof(header) - 1);
+        if (capacity - used_ < size) {
+            return nullptr;
+        }
+        header *h = reinterpret_cast<header*>(base_.get() + used_);
+        h->prev_ = top_;
+        h->owner_ = this;
+        h->freed_.store(false, std::memory_order_relaxed);
+        top_ = h;
+        used_ += size;
+        return h + 1;
+    }
+
+    void reclaim() noexcept {
+        while (top_ != nullptr && top_->freed_.load(std::memory_order_acquire)) {
+            used_ = reinterpret_cast<char*>(top_) - base_.get();
+            top_ = top_->prev_;
+        }
+    }
+
+    static inline thread_local std::unique_ptr<fork_frame_stack> localStack_;
+
+    struct aligned_deleter {
+        void operator()(char *p) const noexcept { ::operator delete(p, std::align_val_t(alignof(header))); }
+    };
+    std::unique_ptr<char, aligned_deleter> base_{
+        static_cast<char*>(::operator new(capacity, std::align_val_t(alignof(header))))
+    };
+    size_t used_ = 0;
+    header *top_ = nullptr;
+};
+
+namespace fork_join {
+    struct sync_t {};
+    template<class T> class spawn_awaitable;
+    template<class T> class run_awaitable;
+}
+
+class fork_promise_base {
+public:
+    static void *operator new(size_t n) {
+        return fork_frame_stack::allocate(n);
+    }
+
+    static void operator delete(void *p, size_t) noexcept {
+        fork_frame_stack::deallocate(p);
+    }
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    class final_awaiter {
+    public:
+        bool await_ready() noexcept { return false; }
+
+        template<class P>
+        std::coroutine_handle<void> await_suspend(std::coroutine_handle<P> h) noexcept {
+            fork_promise_base& self = h.promise();
+            assert(self.join_.load(std::memory_order_relaxed) == 1 && "fork_task returned without syncing");
+            fork_promise_base *parent = self.parent_;
+            std::coroutine_handle<void> next = self.continuation_;
+            h.destroy();
+            if (parent == nullptr) {
+                return next;  // a root task; resume whoever ran it
+            }
+            if (parent->join_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                return next;  // the parent was stolen, and is waiting in sync() for us
+            }
+            // Usually this pops our own parent's continuation, which nobody stole.
+            if (auto *w = work_stealing_pool::current_worker()) {
+                if (auto h2 = w->pop()) {
+                    return h2;
+                }
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    final_awaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() noexcept {
+        std::terminate();
+    }
+
+    template<class A>
+    A&& await_transform(A&& a) noexcept {
+        return static_cast<A&&>(a);
+    }
+
+    auto await_transform(fork_join::sync_t) noexcept {
+        struct awaiter {
+            fork_promise_base *self_;
+            bool await_ready() noexcept {
+                return self_->join_.load(std::memory_order_acquire) == 1;
+            }
+            bool await_suspend(std::coroutine_handle<void>) noexcept {
+                // Give up our own reference; the last child to finish resumes us.
+                return self_->join_.fetch_sub(1, std::memory_order_acq_rel) != 1;
+            }
+            void await_resume() noexcept {
+                self_->join_.store(1, std::memory_order_relaxed);
+            }
+        };
+        return awaiter{this};
+    }
+
+private:
+    template<class T> friend class fork_join::spawn_awaitable;
+    template<class T> friend class fork_join::run_awaitable;
+
+    // One reference for each unfinished child, plus one for ourselves until we sync.
+    std::atomic<long> join_{1};
+    fork_promise_base *parent_ = nullptr;
+    std::coroutine_handle<void> continuation_;
+};
+
+template<class T>
+class fork_promise : public fork_promise_base {
+public:
+    fork_task<T> get_return_object() noexcept;
+
+    template<class U>
+    void return_value(U&& value) {
+        *out_ = static_cast<U&&>(value);
+    }
+
+private:
+    template<class U> friend class fork_join::spawn_awaitable;
+    template<class U> friend class fork_join::run_awaitable;
+    T *out_ = nullptr;
+};
+
+template<>
+class fork_promise<void> : public fork_promise_base {
+public:
+    fork_task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+};
+
+template<class T>
+class fork_task {
+public:
+    using promise_type = fork_promise<T>;
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    explicit fork_task(handle_t h) noexcept : coro_(h) {}
+
+    fork_task(fork_task&& t) noexcept : coro_(std::exchange(t.coro_, {})) {}
+
+    ~fork_task() {
+        if (coro_) {
+            coro_.destroy();
+        }
+    }
+
+private:
+    template<class U> friend class fork_join::spawn_awaitable;
+    template<class U> friend class fork_join::run_awaitable;
+
+    // Once started, a fork_task's frame destroys itself when it completes.
+    handle_t release() noexcept { return std::exchange(coro_, {}); }
+
+    handle_t coro_;
+};
+
+template<class T>
+fork_task<T> fork_promise<T>::get_return_object() noexcept
+{
+    return fork_task<T>(std::coroutine_handle<fork_promise<T>>::from_promise(*this));
+}
+
+inline fork_task<void> fork_promise<void>::get_return_object() noexcept
+{
+    return fork_task<void>(std::coroutine_handle<fork_promise<void>>::from_promise(*this));
+}
+
+namespace fork_join {
+
+    template<class T>
+    class spawn_awaitable {
+    public:
+        explicit spawn_awaitable(fork_task<T> child, T *out) noexcept : child_(std::move(child)), out_(out) {}
+
+        bool await_ready() noexcept { return false; }
+
+        template<class P>
+        std::coroutine_handle<void> await_suspend(std::coroutine_handle<P> parent) {
+            auto *w = work_stealing_pool::current_worker();
+            assert(w != nullptr && "fork_join::spawn outside of a work_stealing_pool");
+            fork_promise_base& p = parent.promise();
+            auto child = child_.release();
+            fork_promise<T>& c = child.promise();
+            c.parent_ = &p;
+            c.continuation_ = parent;
+            if constexpr (!std::is_void_v<T>) {
+                c.out_ = out_;
+            }
+            p.join_.fetch_add(1, std::memory_order_relaxed);
+            if (!w->push(parent)) {
+                w->pool()->post(parent);
+            }
+            return child;
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        fork_task<T> child_;
+        T *out_;
+    };
+
+    template<class T>
+    auto spawn(fork_task<T> child, T& out) noexcept {
+        return spawn_awaitable<T>(std::move(child), &out);
+    }
+
+    inline auto spawn(fork_task<void> child) noexcept {
+        return spawn_awaitable<void>(std::move(child), nullptr);
+    }
+
+    inline sync_t sync() noexcept {
+        return {};
+    }
+
+    template<class T>
+    struct run_result {
+        T value_{};
+        T *out() noexcept { return &value_; }
+        T get() { return std::move(value_); }
+    };
+
+    template<>
+    struct run_result<void> {
+        void *out() noexcept { return nullptr; }
+        void get() noexcept {}
+    };
+
+    template<class T>
+    class run_awaitable {
+    public:
+        explicit run_awaitable(work_stealing_pool *pool, fork_task<T> root) noexcept :
+            pool_(pool), root_(std::move(root))
+        {}
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<void> h) {
+            auto root = root_.release();
+            root.promise().continuation_ = h;
+            if constexpr (!std::is_void_v<T>) {
+                root.promise().out_ = result_.out();
+            }
+            pool_->post(root);
+        }
+
+        T await_resume() {
+            return result_.get();
+        }
+
+    private:
+        work_stealing_pool *pool_;
+        fork_task<T> root_;
+        run_result<T> result_;
+    };
+
+    template<class T>
+    auto run(work_stealing_pool& pool, fork_task<T> root) noexcept {
+        return run_awaitable<T>(&pool, std::move(root));
+    }
+
+} // namespace fork_join
+
+#endif // INCLUDED_CORO_FORK_JOIN_H
@@ -0,0 +1,222 @@
+#ifndef INCLUDED_CORO_FRAME_PROFILE_H
+#define INCLUDED_CORO_FRAME_PROFILE_H
+
+#include <cstddef>
+
+// Coroutine frame allocation profiling. Compile with -DCORO_FRAME_PROFILE
+// and every promise type deriving from frame_profiled<P> (task, the
+// generators, co_optional) allocates its frames through a hook that counts
+// frames per promise type, keeps a histogram of their sizes, and tracks the
+// high-water mark of frames alive at once. frame_profile_report(os) prints
+// all that, plus every frame still alive, with the stack that created it.
+// If any frames are still alive at exit, the report goes to stderr then:
+// a task abandoned while suspended, or a shared_generator kept alive by a
+// reference cycle, shows up there.
+//
+// Every allocation and deallocation takes a global mutex, and captures up to
+// CORO_FRAME_PROFILE_STACK_DEPTH return addresses (default 8; 0 to skip);
+// this is a debugging tool, not something to leave on. Addresses are printed
+// with backtrace_symbols; link with -rdynamic, or feed them to addr2line.
+// Without the macro, nothing derives from frame_profiled<P> (an empty
+// struct), and the other headers don't include this one.
+
+#ifndef CORO_FRAME_PROFILE
+
+template<class Promise>
+struct frame_profiled {};
+
+#else
+
+#include <atomic>
+#include <bit>
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <stdlib.h>
+#include <typeinfo>
+
+#ifndef CORO_FRAME_PROFILE_STACK_DEPTH
+#define CORO_FRAME_PROFILE_STACK_DEPTH 8
+#endif
+
+namespace frame_profile_detail {
+
+    inline void bump_high_water(std::atomic<size_t>& hw, size_t n) noexcept {
+        size_t old = hw.load(std::memory_order_relaxed);
+        while (old < n && !hw.compare_exchange_weak(old, n, std::memory_order_relaxed)) {}
+    }
+
+    struct type_stats {
+        explicit type_stats(const std::type_info& type) noexcept : type_(&type) {}
+
+        const std::type_info *type_;
+        type_stats *next_ = nullptr;
+        std::atomic<size_t> allocated_{0};
+        std::atomic<size_t> live_{0};
+        std::atomic<size_t> highWater_{0};
+        std::atomic<size_t> bytes_{0};
+        // sizes_[k] counts frames of more than 2^(k-1) and at most 2^k bytes.
+        std::atomic<size_t> sizes_[64] = {};
+    };
+
+    struct alignas(std::max_align_t) frame_header {
+        type_stats *stats_;
+        frame_header *prev_;
+        frame_header *next_;
+        size_t size_;
+        int depth_;
+        void *stack_[CORO_FRAME_PROFILE_STACK_DEPTH > 0 ? CORO_FRAME_PROFILE_STACK_DEPTH : 1];
+    };
+
+    inline void report_at_exit();
+
+    // Never destroyed, so that frames (and the exit report) may outlive
+    // static destruction.
+    struct registry {
+        std::mutex mut_;
+        type_stats *types_ = nullptr;
+        frame_header *live_ = nullptr;
+        std::atomic<size_t> liveCount_{0};
+        std::atomic<size_t> highWater_{0};
+
+        registry() {
+            std::atexit(report_at_exit);
+        }
+
+        static registry& get() {
+            static registry *r = new registry;
+            return *r;
+        }
+    };
+
+    template<class Promise>
+    type_stats& stats_for() {
+        static type_stats *s = []() {
+            type_stats *t = new type_stats(typeid(Promise));
+            registry& reg = registry::get();
+            std::lock_guard<std::mutex> lock(reg.mut_);
+            t->next_ = reg.types_;
+            reg.types_ = t;
+            return t;
+        }();
+        return *s;
+    }
+
+    [[gnu::noinline]] inline void *allocate(type_stats& stats, size_t n) {
+        void *raw = ::operator new(sizeof(frame_header) + n);
+        frame_header *h = ::new (raw) frame_header;
+        h->stats_ = &stats;
+        h->size_ = n;
+        h->depth_ = 0;
+        if (CORO_FRAME_PROFILE_STACK_DEPTH > 0) {
+            // Skip this function's own entry.
+            void *stack[CORO_FRAME_PROFILE_STACK_DEPTH + 1];
+            int depth = backtrace(stack, CORO_FRAME_PROFILE_STACK_DEPTH + 1);
+            for (int i = 1; i < depth; ++i) {
+                h->stack_[h->depth_++] = stack[i];
+            }
+        }
+
+        stats.allocated_.fetch_add(1, std::memory_order_relaxed);
+        stats.bytes_.fetch_add(n, std::memory_order_relaxed);
+        stats.sizes_[std::bit_width(n - (n != 0))].fetch_add(1, std::memory_order_relaxed);
+        bump_high_water(stats.highWater_, stats.live_.fetch_add(1, std::memory_order_relaxed) + 1);
+
+        registry& reg = registry::get();
+        bump_high_water(reg.highWater_, reg.liveCount_.fetch_add(1, std::memory_order_relaxed) + 1);
+        std::lock_guard<std::mutex> lock(reg.mut_);
+        h->prev_ = nullptr;
+        h->next_ = reg.live_;
+        if (reg.live_ != nullptr) {
+            reg.live_->prev_ = h;
+        }
+        reg.live_ = h;
+        return h + 1;
+    }
+
+    [[gnu::noinline]] inline void deallocate(void *p) noexcept {
+        frame_header *h = static_cast<frame_header*>(p) - 1;
+        h->stats_->live_.fetch_sub(1, std::memory_order_relaxed);
+        registry& reg = registry::get();
+        reg.liveCount_.fetch_sub(1, std::memory_order_relaxed);
+        if (true) {
+            std::lock_guard<std::mutex> lock(reg.mut_);
+            (h->prev_ != nullptr ? h->prev_->next_ : reg.live_) = h->next_;
+            if (h->next_ != nullptr) {
+                h->next_->prev_ = h->prev_;
+            }
+        }
+        h->~frame_header();
+        ::operator delete(h);
+    }
+
+    inline void print_type(std::ostream& os, const std::type_info& type) {
+        int status = 0;
+        char *name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+        os << (name != nullptr ? name : type.name());
+        free(name);
+    }
+
+} // namespace frame_profile_detail
+
+template<class Promise>
+struct frame_profiled {
+    static void *operator new(size_t n) {
+        return frame_profile_detail::allocate(frame_profile_detail::stats_for<Promise>(), n);
+    }
+    static void operator delete(void *p) noexcept {
+        frame_profile_detail::deallocate(p);
+    }
+};
+
+inline size_t frame_profile_live_frames() noexcept
+{
+    return frame_profile_detail::registry::get().liveCount_.load(std::memory_order_relaxed);
+}
+
+inline void frame_profile_report(std::ostream& os)
+{
+    using namespace frame_profile_detail;
+    registry& reg = registry::get();
+    std::lock_guard<std::mutex> lock(reg.mut_);
+    os << "coroutine frames: " << reg.liveCount_.load(std::memory_order_relaxed) << " live, "
+       << reg.highWater_.load(std::memory_order_relaxed) << " at most\n";
+    for (type_stats *t = reg.types_; t != nullptr; t = t->next_) {
+        size_t allocated = t->allocated_.load(std::memory_order_relaxed);
+        os << "  ";
+        print_type(os, *t->type_);
+        os << ": " << allocated << " allocated, "
+           << t->live_.load(std::memory_order_relaxed) << " live, "
+           << t->highWater_.load(std::memory_order_relaxed) << " at most, "
+           << (allocated ? t->bytes_.load(std::memory_order_relaxed) / allocated : 0) << " bytes on average\n";
+        for (int k = 0; k < 64; ++k) {
+            if (size_t n = t->sizes_[k].load(std::memory_order_relaxed)) {
+                os << "    <= " << (size_t(1) << k) << " bytes: " << n << "\n";
+            }
+        }
+    }
+    for (frame_header *h = reg.live_; h != nullptr; h = h->next_) {
+        os << "live frame " << static_cast<void*>(h + 1) << ", " << h->size_ << " bytes, ";
+        print_type(os, *h->stats_->type_);
+        os << ", created at:\n";
+        char **names = backtrace_symbols(h->stack_, h->depth_);
+        for (int i = 0; i < h->depth_; ++i) {
+            os << "  #" << i << " " << (names != nullptr ? names[i] : "?") << "\n";
+        }
+        free(names);
+    }
+}
+
+inline void frame_profile_detail::report_at_exit()
+{
+    if (frame_profile_live_frames() != 0) {
+        frame_profile_report(std::cerr);
+    }
+}
+
+#endif // CORO_FRAME_PROFILE
+
+#endif // INCLUDED_CORO_FRAME_PROFILE_H
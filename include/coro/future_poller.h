@@ -0,0 +1,189 @@
+#ifndef INCLUDED_CORO_FUTURE_POLLER_H
+#define INCLUDED_CORO_FUTURE_POLLER_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "co_future.h"
+#include "concepts.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// future_poller bridges std::futures, which have no way to register a
+// continuation, into coroutines. One background thread watches every
+// registered future with wait_for(0), so ten thousand pending futures
+// cost one thread rather than ten thousand.
+//
+// co_await poller.when_ready(f) suspends until f is ready, and resumes on the
+// poller thread. poller.adopt(std::move(f), ex) returns a co_future for f's
+// result, which hops to executor ex before completing.
+//
+// A deferred future (from std::async's default launch policy, say) would
+// never become ready by itself, so it counts as ready at once: the awaiter
+// doesn't suspend, and f.get() runs the deferred function on its thread.
+// Awaiting a future with no shared state throws std::future_error.
+//
+// The poller backs off adaptively: after a sweep that finds nothing ready it
+// sleeps twice as long as last time, up to maxBackoff; any ready future, or
+// any new registration, drops it back to minBackoff.
+// The destructor waits until every registered future has been resumed.
+
+class future_poller {
+    template<class T> class ready_awaitable;
+public:
+    explicit future_poller(std::chrono::microseconds minBackoff = std::chrono::microseconds(50),
+                           std::chrono::microseconds maxBackoff = std::chrono::milliseconds(10)) :
+        minBackoff_(minBackoff),
+        maxBackoff_(std::max(minBackoff, maxBackoff)),
+        thread_([this]() { run(); })
+    {}
+
+    ~future_poller() {
+        std::unique_lock<std::mutex> lk(mut_);
+        while (pendingCount_ != 0) {
+            drained_.wait(lk);
+        }
+        stopping_ = true;
+        cv_.notify_all();
+        lk.unlock();
+        thread_.join();
+    }
+
+    future_poller(const future_poller&) = delete;
+    future_poller& operator=(const future_poller&) = delete;
+
+    // f must outlive the co_await.
+    template<class T>
+    ready_awaitable<T> when_ready(std::future<T>& f) {
+        if (!f.valid()) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+        return ready_awaitable<T>(this, &f);
+    }
+
+    template<Executor E, class T>
+    co_future<T> adopt(std::future<T> f, E ex) {
+        co_await when_ready(f);
+        co_await ex.schedule();
+        co_return f.get();
+    }
+
+    template<class T>
+    co_future<T> adopt(std::future<T> f) {
+        return adopt(std::move(f), inline_executor());
+    }
+
+private:
+    struct poll_node {
+        bool (*is_ready_)(poll_node *) = nullptr;
+        std::coroutine_handle<void> coro_;
+    };
+
+    template<class T>
+    class ready_awaitable : private poll_node {
+    public:
+        explicit ready_awaitable(future_poller *poller, std::future<T> *f) noexcept :
+            poller_(poller), f_(f)
+        {
+            this->is_ready_ = [](poll_node *node) {
+                auto *self = static_cast<ready_awaitable*>(node);
+                return self->f_->wait_for(std::chrono::seconds(0)) != std::future_status::timeout;
+            };
+        }
+
+        bool await_ready() {
+            return this->is_ready_(this);
+        }
+
+        void await_suspend(std::coroutine_handle<void> h) {
+            this->coro_ = h;
+            poller_->enqueue(this);
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        future_poller *poller_;
+        std::future<T> *f_;
+    };
+
+    void enqueue(poll_node *node) {
+        std::lock_guard<std::mutex> lock(mut_);
+        incoming_.push_back(node);
+        ++pendingCount_;
+        cv_.notify_all();
+    }
+
+    void run() {
+        std::vector<poll_node *> watching;
+        std::vector<poll_node *> ready;
+        auto backoff = minBackoff_;
+        while (true) {
+            if (true) {
+                std::unique_lock<std::mutex> lk(mut_);
+                if (watching.empty() && incoming_.empty()) {
+                    if (stopping_) {
+                        return;
+                    }
+                    cv_.wait(lk, [&]() { return stopping_ || !incoming_.empty(); });
+                    backoff = minBackoff_;
+                } else if (incoming_.empty()) {
+                    if (cv_.wait_for(lk, backoff, [&]() { return !incoming_.empty(); })) {
+                        backoff = minBackoff_;
+                    }
+                }
+                watching.insert(watching.end(), incoming_.begin(), incoming_.end());
+                incoming_.clear();
+            }
+
+            // Resuming a node may destroy it, so take it off the list first.
+            auto it = std::partition(watching.begin(), watching.end(), [](poll_node *node) {
+                return !node->is_ready_(node);
+            });
+            ready.assign(it, watching.end());
+            watching.erase(it, watching.end());
+            if (ready.empty()) {
+                backoff = std::min(backoff * 2, maxBackoff_);
+                continue;
+            }
+            backoff = minBackoff_;
+            for (poll_node *node : ready) {
+                node->coro_.resume();
+            }
+            std::lock_guard<std::mutex> lock(mut_);
+            pendingCount_ -= ready.size();
+            if (pendingCount_ == 0) {
+                drained_.notify_all();
+            }
+        }
+    }
+
+    std::chrono::microseconds minBackoff_;
+    std::chrono::microseconds maxBackoff_;
+    std::mutex mut_;
+    std::condition_variable cv_;
+    std::condition_variable drained_;
+    std::vector<poll_node *> incoming_;
+    size_t pendingCount_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif // INCLUDED_CORO_FUTURE_POLLER_H
@@ -0,0 +1,216 @@
+#ifndef INCLUDED_CORO_GREEN_SCHEDULER_H
+#define INCLUDED_CORO_GREEN_SCHEDULER_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#ifdef CORO_FRAME_PROFILE
+#include "frame_profile.h"
+#endif
+
+#include <exception>
+#include <utility>
+
+// A cooperative, single-threaded, round-robin scheduler of green threads:
+// coroutines returning green_thread, shaped like McNellis's resumable_thing,
+// except that they start lazily and the scheduler decides who runs next.
+// spawn() queues a green thread; run() resumes the queue's front, and
+// returns once the queue is empty. Inside a green thread,
+// co_await yield_now() moves it to the back of the queue and transfers
+// straight to the new front, so a switch is a few pointer writes and an
+// indirect jump. Every so often the transfer goes back through run()
+// instead, for compilers that don't turn symmetric transfer into a tail
+// call (as at -O0, or under ASan) and would otherwise overflow the stack.
+//
+// The run queue is intrusive (its links live in the green threads'
+// promises), so queueing never allocates; a million green threads cost
+// their million frames and nothing more. The scheduler owns every thread
+// it's been given, and destroying it destroys those that haven't finished,
+// queued or not: a second intrusive list links every spawned thread until
+// its frame is destroyed.
+// The first exception to escape a green thread stops run(), which rethrows it.
+//
+// A green thread that co_awaits anything other than yield_now() leaves the
+// queue; whoever resumes it must do so on the scheduler's thread, and
+// before the scheduler is destroyed.
+
+class green_scheduler;
+
+class green_thread {
+public:
+    struct promise_type;
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    struct promise_type
+#ifdef CORO_FRAME_PROFILE
+        : frame_profiled<promise_type>
+#endif
+    {
+        green_scheduler *sched_ = nullptr;
+        promise_type *next_ = nullptr;
+        promise_type *prevSpawned_ = nullptr;
+        promise_type *nextSpawned_ = nullptr;
+
+        promise_type() = default;
+        ~promise_type();
+
+        green_thread get_return_object() { return green_thread(handle_t::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept;
+        void return_void() {}
+        void unhandled_exception() noexcept;
+    };
+
+    green_thread(green_thread&& rhs) noexcept : coro_(std::exchange(rhs.coro_, nullptr)) {}
+    green_thread& operator=(green_thread rhs) noexcept { std::swap(coro_, rhs.coro_); return *this; }
+    ~green_thread() { if (coro_) coro_.destroy(); }
+
+private:
+    friend class green_scheduler;
+    explicit green_thread(handle_t h) noexcept : coro_(h) {}
+
+    handle_t coro_ = nullptr;
+};
+
+class green_scheduler {
+    using promise_type = green_thread::promise_type;
+    using handle_t = green_thread::handle_t;
+
+public:
+    struct yield_awaiter {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<void> await_suspend(handle_t h) const noexcept {
+            green_scheduler& s = *h.promise().sched_;
+            s.push(h.promise());
+            return s.next();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    // Destroys the finished coroutine and transfers to the next in line,
+    // or back to run() if there's none.
+    struct final_awaiter {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<void> await_suspend(handle_t h) const noexcept {
+            green_scheduler& s = *h.promise().sched_;
+            h.destroy();
+            if (s.exception_ != nullptr || s.head_ == nullptr) {
+                return std::noop_coroutine();
+            }
+            return s.next();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    green_scheduler() = default;
+    green_scheduler(const green_scheduler&) = delete;
+    green_scheduler& operator=(const green_scheduler&) = delete;
+
+    // Each frame unlinks itself as it goes.
+    ~green_scheduler() {
+        while (spawned_ != nullptr) {
+            handle_t::from_promise(*spawned_).destroy();
+        }
+    }
+
+    void spawn(green_thread t) noexcept {
+        promise_type& p = std::exchange(t.coro_, nullptr).promise();
+        p.sched_ = this;
+        p.nextSpawned_ = spawned_;
+        if (spawned_ != nullptr) {
+            spawned_->prevSpawned_ = &p;
+        }
+        spawned_ = &p;
+        push(p);
+    }
+
+    void run() {
+        while (exception_ == nullptr) {
+            promise_type *p = pop();
+            if (p == nullptr) {
+                break;
+            }
+            transfers_ = 0;
+            handle_t::from_promise(*p).resume();
+        }
+        if (exception_ != nullptr) {
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+        }
+    }
+
+    bool empty() const noexcept { return head_ == nullptr; }
+
+private:
+    friend struct green_thread::promise_type;
+
+    void push(promise_type& p) noexcept {
+        p.next_ = nullptr;
+        (tail_ != nullptr ? tail_->next_ : head_) = &p;
+        tail_ = &p;
+    }
+
+    // The coroutine to transfer to from a non-empty queue.
+    std::coroutine_handle<void> next() noexcept {
+        if (++transfers_ == max_transfers) {
+            return std::noop_coroutine();
+        }
+        return handle_t::from_promise(*pop());
+    }
+
+    promise_type *pop() noexcept {
+        promise_type *p = head_;
+        if (p != nullptr) {
+            head_ = p->next_;
+            if (head_ == nullptr) {
+                tail_ = nullptr;
+            }
+        }
+        return p;
+    }
+
+    static constexpr unsigned max_transfers = 256;
+
+    promise_type *head_ = nullptr;
+    promise_type *tail_ = nullptr;
+    promise_type *spawned_ = nullptr;
+    unsigned transfers_ = 0;
+    std::exception_ptr exception_ = nullptr;
+};
+
+inline green_thread::promise_type::~promise_type()
+{
+    if (sched_ != nullptr) {
+        (prevSpawned_ != nullptr ? prevSpawned_->nextSpawned_ : sched_->spawned_) = nextSpawned_;
+        if (nextSpawned_ != nullptr) {
+            nextSpawned_->prevSpawned_ = prevSpawned_;
+        }
+    }
+}
+
+inline auto green_thread::promise_type::final_suspend() noexcept
+{
+    return green_scheduler::final_awaiter{};
+}
+
+inline void green_thread::promise_type::unhandled_exception() noexcept
+{
+    if (sched_->exception_ == nullptr) {
+        sched_->exception_ = std::current_exception();
+    }
+}
+
+inline green_scheduler::yield_awaiter yield_now() noexcept
+{
+    return {};
+}
+
+#endif // INCLUDED_CORO_GREEN_SCHEDULER_H
@@ -0,0 +1,233 @@
+#ifndef INCLUDED_CORO_INTERLEAVE_H
+#define INCLUDED_CORO_INTERLEAVE_H
+
+// Original source:
+// http://www.vldb.org/pvldb/vol11/p230-psaropoulos.pdf (Psaropoulos, Legler, May, Ailamaki, "Interleaving with Coroutines")
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Memory-bound lookups (hash probes, tree descents, binary searches) spend most
+// of their time waiting on cache misses. Interleaving hides that latency on a
+// single core: write each lookup as an interleaved_task<T>, and
+//
+//     co_await prefetch(p);
+//
+// before touching *p. That issues the prefetch and suspends, and the
+// interleave_group moves on to the next lookup of its fixed-size round-robin
+// group; by the time it comes back around, the line has (hopefully) arrived.
+//
+// The group preallocates one frame slot per member, and every lookup it starts
+// is constructed directly into its slot's storage, so running a million lookups
+// doesn't make a million heap allocations. A frame that doesn't fit in FrameSize
+// bytes falls back to the heap. Exceptions escaping a lookup terminate; if
+// makeTask or onResult throws, run() destroys the lookups in flight and
+// rethrows.
+
+namespace interleave_detail {
+    // Every interleaved_task frame is preceded by a header saying whether it
+    // came from the heap or from an interleave_group's slot.
+    struct alignas(std::max_align_t) frame_header {
+        bool fromHeap_;
+    };
+
+    // Where the next interleaved_task frame created on this thread should go.
+    struct frame_slot {
+        void *storage_ = nullptr;
+        size_t size_ = 0;
+    };
+    inline thread_local frame_slot nextSlot;
+
+    // Clears nextSlot however the task's creation ends, so that no later
+    // frame is put into a slot that's in use or freed.
+    struct slot_guard {
+        ~slot_guard() { nextSlot = {}; }
+    };
+
+    // Destroys the frames of the members still in flight when run() unwinds.
+    template<class Member>
+    struct members_guard {
+        std::vector<Member>& members_;
+        ~members_guard() {
+            for (Member& m : members_) {
+                if (m.coro_) {
+                    m.coro_.destroy();
+                }
+            }
+        }
+    };
+}
+
+template<class T>
+class interleaved_task {
+public:
+    class promise_type {
+        using header_t = interleave_detail::frame_header;
+    public:
+        static void *operator new(size_t n) {
+            auto& slot = interleave_detail::nextSlot;
+            if (slot.storage_ != nullptr && n <= slot.size_) {
+                return std::exchange(slot.storage_, nullptr);
+            }
+            header_t *h = static_cast<header_t*>(::operator new(sizeof(header_t) + n));
+            h->fromHeap_ = true;
+            return h + 1;
+        }
+
+        static void operator delete(void *p) noexcept {
+            header_t *h = static_cast<header_t*>(p) - 1;
+            if (h->fromHeap_) {
+                ::operator delete(h);
+            }
+        }
+
+        interleaved_task get_return_object() noexcept {
+            return interleaved_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        template<class U>
+        void return_value(U&& value) {
+            value_ = static_cast<U&&>(value);
+        }
+
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        T& value() noexcept { return value_; }
+
+    private:
+        T value_{};
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    explicit interleaved_task(handle_t h) noexcept : coro_(h) {}
+    interleaved_task(interleaved_task&& t) noexcept : coro_(std::exchange(t.coro_, {})) {}
+    ~interleaved_task() {
+        if (coro_) {
+            coro_.destroy();
+        }
+    }
+
+    handle_t release() noexcept { return std::exchange(coro_, {}); }
+
+private:
+    handle_t coro_;
+};
+
+class prefetch_awaitable {
+public:
+    explicit prefetch_awaitable(const void *p) noexcept : p_(p) {}
+
+    bool await_ready() noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<void>) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p_);
+#endif
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    const void *p_;
+};
+
+inline prefetch_awaitable prefetch(const void *p) noexcept {
+    return prefetch_awaitable(p);
+}
+
+template<size_t FrameSize = 512>
+class interleave_group {
+public:
+    explicit interleave_group(size_t width) :
+        width_(width == 0 ? 1 : width),
+        storage_(static_cast<char*>(::operator new(width_ * slotBytes, std::align_val_t(64))))
+    {
+        for (size_t i = 0; i < width_; ++i) {
+            ::new (storage_.get() + i * slotBytes) header_t{false};
+        }
+    }
+
+    size_t width() const noexcept { return width_; }
+
+    // Runs makeTask(i) for every i in [0, count), keeping up to width() of them
+    // in flight at once, and calls onResult(i, value) as each one completes.
+    // Results arrive in completion order, not index order.
+    template<class MakeTask, class OnResult>
+    void run(size_t count, MakeTask makeTask, OnResult onResult) {
+        using task_t = decltype(makeTask(size_t()));
+        using handle_t = typename task_t::handle_t;
+
+        struct member {
+            handle_t coro_;
+            size_t index_;
+        };
+        std::vector<member> members(width_);
+        interleave_detail::members_guard<member> guard{members};
+        size_t next = 0;
+        size_t active = 0;
+
+        auto start = [&](size_t slot) {
+            interleave_detail::nextSlot = {storage_.get() + slot * slotBytes + headerBytes, FrameSize};
+            interleave_detail::slot_guard reset;
+            members[slot] = {makeTask(next).release(), next};
+            ++next;
+        };
+        for (size_t slot = 0; slot < width_ && next < count; ++slot) {
+            start(slot);
+            ++active;
+        }
+        while (active != 0) {
+            for (size_t slot = 0; slot < width_; ++slot) {
+                member& m = members[slot];
+                if (!m.coro_) {
+                    continue;
+                }
+                m.coro_.resume();
+                if (m.coro_.done()) {
+                    onResult(m.index_, std::move(m.coro_.promise().value()));
+                    m.coro_.destroy();
+                    m.coro_ = nullptr;
+                    if (next < count) {
+                        start(slot);
+                    } else {
+                        --active;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    using header_t = interleave_detail::frame_header;
+    static constexpr size_t headerBytes = sizeof(header_t);
+    static constexpr size_t slotBytes = (headerBytes + FrameSize + 63) & ~size_t(63);
+
+    struct aligned_deleter {
+        void operator()(char *p) const noexcept { ::operator delete(p, std::align_val_t(64)); }
+    };
+
+    size_t width_;
+    std::unique_ptr<char, aligned_deleter> storage_;
+};
+
+#endif // INCLUDED_CORO_INTERLEAVE_H
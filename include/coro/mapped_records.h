@@ -0,0 +1,175 @@
+#ifndef INCLUDED_CORO_MAPPED_RECORDS_H
+#define INCLUDED_CORO_MAPPED_RECORDS_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "unique_generator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// mapped_records(path, delimiter) yields each delimiter-terminated record of
+// a file as a std::string_view straight into a read-only, MADV_SEQUENTIAL
+// memory mapping of it: no allocation and no copy per record. The scan for
+// each delimiter is a memchr, which the C library vectorizes. As with
+// std::getline, a final record needn't be terminated, and consecutive
+// delimiters yield empty records.
+//
+// The views are valid only as long as the mapping: for the path overload,
+// until the generator is destroyed. To share one mapping among parallel
+// consumers, open a mapped_file and give each consumer
+// mapped_records(file, delimiter, i, n): the file is split into n byte
+// ranges, and shard i yields the records that start in the i'th. Together
+// the shards yield every record exactly once.
+//
+// A shards of zero, or a shard not less than shards, throws
+// std::invalid_argument from mapped_records() itself. A file that can't be
+// opened or mapped throws std::system_error; in the path overload, from the
+// generator's begin().
+
+class mapped_file {
+public:
+    explicit mapped_file(const char *path) {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            int e = errno;
+            ::close(fd);
+            throw std::system_error(e, std::generic_category(), path);
+        }
+        size_ = st.st_size;
+        if (size_ != 0) {
+            void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                int e = errno;
+                ::close(fd);
+                throw std::system_error(e, std::generic_category(), path);
+            }
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+        }
+        ::close(fd);
+    }
+
+    mapped_file(mapped_file&& rhs) noexcept :
+        data_(std::exchange(rhs.data_, nullptr)),
+        size_(std::exchange(rhs.size_, 0))
+    {}
+
+    mapped_file& operator=(mapped_file&& rhs) noexcept {
+        auto copy = std::move(rhs);
+        std::swap(data_, copy.data_);
+        std::swap(size_, copy.size_);
+        return *this;
+    }
+
+    ~mapped_file() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    const char *data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+namespace mapped_records_detail {
+    // Steps through the records that start in one shard's byte range.
+    class cursor {
+    public:
+        explicit cursor(const mapped_file& file, char delimiter, size_t shard, size_t shards) :
+            stop_(file.data() + file.size()),
+            delimiter_(delimiter)
+        {
+            size_t size = file.size();
+            size_t per = size / shards;
+            size_t extra = size % shards;
+            size_t lo = per * shard + std::min(shard, extra);
+            size_t hi = lo + per + (shard < extra);
+            p_ = file.data() + lo;
+            end_ = file.data() + hi;
+            if (lo != 0 && p_[-1] != delimiter_) {
+                // The record in progress at lo belongs to the previous shard.
+                auto *q = static_cast<const char*>(std::memchr(p_, delimiter_, stop_ - p_));
+                p_ = (q != nullptr) ? q + 1 : stop_;
+            }
+        }
+
+        bool next(std::string_view& record) noexcept {
+            if (p_ >= end_) {
+                return false;
+            }
+            auto *q = static_cast<const char*>(std::memchr(p_, delimiter_, stop_ - p_));
+            if (q == nullptr) {
+                q = stop_;
+            }
+            record = std::string_view(p_, q - p_);
+            p_ = (q == stop_) ? stop_ : q + 1;
+            return true;
+        }
+
+    private:
+        const char *p_;
+        const char *end_;
+        const char *stop_;
+        char delimiter_;
+    };
+
+    inline unique_generator<std::string_view> shard_records(const mapped_file& file, char delimiter, size_t shard, size_t shards)
+    {
+        cursor c(file, delimiter, shard, shards);
+        std::string_view record;
+        while (c.next(record)) {
+            co_yield record;
+        }
+    }
+}
+
+inline unique_generator<std::string_view> mapped_records(const mapped_file& file, char delimiter = '\n', size_t shard = 0, size_t shards = 1)
+{
+    if (shards == 0 || shard >= shards) {
+        throw std::invalid_argument("mapped_records: shard must be less than shards");
+    }
+    return mapped_records_detail::shard_records(file, delimiter, shard, shards);
+}
+
+inline unique_generator<std::string_view> mapped_records(std::string path, char delimiter = '\n')
+{
+    mapped_file file(path.c_str());
+    mapped_records_detail::cursor c(file, delimiter, 0, 1);
+    std::string_view record;
+    while (c.next(record)) {
+        co_yield record;
+    }
+}
+
+#endif // INCLUDED_CORO_MAPPED_RECORDS_H
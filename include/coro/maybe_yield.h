@@ -0,0 +1,62 @@
+#ifndef INCLUDED_CORO_MAYBE_YIELD_H
+#define INCLUDED_CORO_MAYBE_YIELD_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "task.h"
+#include "work_stealing_pool.h"
+
+#include <type_traits>
+
+// co_await maybe_yield() is a cooperative preemption point for code running
+// on a work_stealing_pool. Each call spends one unit of the budget that the
+// worker hands the coroutine whenever it resumes it (pool.set_yield_budget(),
+// default 128); usually that's all it does, and await_ready() returns true.
+// The call that exhausts the budget sends the task to the back of the pool's
+// injection queue, so that other work gets a turn. Off the pool, it never
+// suspends.
+//
+// A generator can call it too, from inside its own loop; but a generator is
+// resumed by whoever is consuming it, not by an executor, so it can't be
+// requeued. Its maybe_yield() only spends budget, and leaves it exhausted,
+// so that the task consuming it yields at its own next maybe_yield().
+
+class maybe_yield_awaiter {
+public:
+    bool await_ready() noexcept {
+        worker_ = work_stealing_pool::current_worker();
+        return worker_ == nullptr || !worker_->spend_budget();
+    }
+
+    template<class P>
+    bool await_suspend(std::coroutine_handle<P> h) {
+        if constexpr (std::is_base_of_v<task_detail::home_base, P>) {
+            worker_->yield(h);
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    work_stealing_pool::worker *worker_;
+};
+
+inline maybe_yield_awaiter maybe_yield() noexcept
+{
+    return {};
+}
+
+#endif // INCLUDED_CORO_MAYBE_YIELD_H
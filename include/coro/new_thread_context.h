@@ -16,12 +16,34 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
+#include "executor_metrics.h"
+#ifdef CORO_TRACE
+#include "trace.h"
+#elif !defined(INCLUDED_CORO_TRACE_HOOKS)
+#define INCLUDED_CORO_TRACE_HOOKS
+// trace.h's hooks, which do nothing without -DCORO_TRACE.
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // CORO_TRACE
+
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
 
 // new_thread_context models ExecutionContext.
-// It has a .get_executor() method whose result models Executor.
+// It has a .get_executor() method whose result models Executor;
+// its running_in_this_thread() is true on any thread the context started.
+// metrics() reports live threads, spawn failures, and the latency from
+// schedule() to the new thread resuming its coroutine.
 
 class new_thread_context {
 public:
@@ -44,19 +66,31 @@ private:
         void await_suspend(std::coroutine_handle<void> h) {
             if (true) {
                 std::lock_guard<std::mutex> lock(context_->mut_);
+                executor_metrics_shard::bump(context_->metrics_.scheduled_);
                 ++context_->activeThreadCount_;
             }
+            trace_emit(trace_event::schedule, "new_thread_context", h.address());
 
             try {
-                std::thread t = std::thread([this, h]() mutable {
+                // Don't capture this: the awaitable may be gone by the time h.resume() returns.
+                auto scheduledAt = std::chrono::steady_clock::now();
+                std::thread t = std::thread([context = context_, h, scheduledAt]() mutable {
+                    auto latency = std::chrono::steady_clock::now() - scheduledAt;
+                    currentContext_ = context;
+                    void *frame = h.address();
+                    trace_emit(trace_event::run_begin, "new_thread_context", frame);
                     h.resume();
-                    std::unique_lock<std::mutex> lock(context_->mut_);
-                    --context_->activeThreadCount_;
-                    std::notify_all_at_thread_exit(context_->cv_, std::move(lock));
+                    trace_emit(trace_event::run_end, "new_thread_context", frame);
+                    std::unique_lock<std::mutex> lock(context->mut_);
+                    executor_metrics_shard::bump(context->metrics_.resumed_);
+                    context->metrics_.record_latency(latency);
+                    --context->activeThreadCount_;
+                    std::notify_all_at_thread_exit(context->cv_, std::move(lock));
                 });
                 t.detach();
             } catch (...) {
                 std::unique_lock<std::mutex> lock(context_->mut_);
+                executor_metrics_shard::bump(context_->metrics_.spawnFailures_);
                 --context_->activeThreadCount_;
                 throw;
             }
@@ -80,16 +114,31 @@ public:
             return schedule_awaitable(context_);
         }
 
+        bool running_in_this_thread() const noexcept {
+            return currentContext_ == context_;
+        }
+
     private:
         new_thread_context *context_;
     };
 
     executor get_executor() { return executor(this); }
 
+    executor_metrics metrics() const {
+        std::lock_guard<std::mutex> lock(mut_);
+        executor_metrics m;
+        metrics_.add_to(m);
+        m.threadsStarted_ = m.scheduled_ - m.spawnFailures_;
+        m.liveThreads_ = activeThreadCount_;
+        return m;
+    }
+
 private:
-    std::mutex mut_;
+    mutable std::mutex mut_;
     std::condition_variable cv_;
     size_t activeThreadCount_ = 0;
+    executor_metrics_shard metrics_;
+    static inline thread_local new_thread_context *currentContext_ = nullptr;
 };
 
 #endif // INCLUDED_CORO_NEW_THREAD_CONTEXT_H
@@ -17,6 +17,10 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
+#ifdef CORO_FRAME_PROFILE
+#include "frame_profile.h"
+#endif
+
 #include <cstdio>
 #include <exception>
 #include <iterator>
@@ -26,7 +30,11 @@ namespace std {
 template<typename Ref, typename Value = std::remove_cvref_t<Ref>>
 class generator {
 public:
-    class promise_type {
+    class promise_type
+#ifdef CORO_FRAME_PROFILE
+        : public frame_profiled<promise_type>
+#endif
+    {
 
         using YieldType = std::conditional_t<
             std::is_reference_v<Ref>,
@@ -0,0 +1,270 @@
+#ifndef INCLUDED_CORO_PARALLEL_ALGORITHMS_H
+#define INCLUDED_CORO_PARALLEL_ALGORITHMS_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "async_manual_reset_event.h"
+#include "async_scope.h"
+#include "async_semaphore.h"
+#include "concepts.h"
+#include "task.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+// Chunked parallel algorithms on any Executor:
+//
+//     co_await parallel_for_each(ex, range, chunk, f);
+//     T sum = co_await parallel_transform_reduce(ex, range, chunk, init, reduce, transform);
+//
+// A random-access range is cut into chunks of `chunk` elements, each
+// scheduled on ex as a task of its own. Any other input range (a
+// unique_generator, say) is pulled by the awaiting coroutine alone, which
+// copies each `chunk` elements into a batch and hands the batch to ex.
+// Either way, at most parallel_batches_in_flight chunks are outstanding at
+// once, and transform_reduce folds each chunk's result onto init as soon as
+// every chunk before it is done. It also holds at most that many results
+// waiting to be folded: while the oldest chunk is slow, it starts no new
+// chunk until that one is done. So memory stays bounded however small the
+// chunks and however long the range.
+//
+// f, transform and reduce are called concurrently from several threads.
+// transform_reduce reduces each chunk left to right, and then the chunks'
+// results onto init in chunk order, so for a given chunk size the result
+// doesn't depend on the number of threads or on timing, even when reduce
+// isn't associative (floating-point addition, string concatenation).
+//
+// The first exception thrown by f, transform or reduce is rethrown once
+// all the chunks are done. The range must outlive the returned task; it
+// does when the call is co_awaited directly.
+
+inline constexpr size_t parallel_batches_in_flight = 64;
+
+namespace parallel_detail {
+    template<class T, class It, class Reduce, class Transform>
+    T reduce_chunk(It first, size_t lo, size_t hi, Reduce& reduce, Transform& transform) {
+        T acc = std::invoke(transform, first[lo]);
+        for (size_t i = lo + 1; i < hi; ++i) {
+            acc = std::invoke(reduce, std::move(acc), std::invoke(transform, first[i]));
+        }
+        return acc;
+    }
+
+    // Gives its batch's permit back however the batch ends.
+    struct permit {
+        async_semaphore *sem_;
+        ~permit() { sem_->release(); }
+    };
+
+    // A chunk's result, which stays put in a deque until every chunk
+    // before it is done and it's folded onto init. A chunk that threw is
+    // done with no value; its exception comes out of the scope's join().
+    template<class T>
+    struct partial {
+        std::optional<T> value_;
+        async_manual_reset_event done_;
+    };
+
+    // Marks its chunk's partial done however the chunk ends.
+    template<class T>
+    struct finisher {
+        partial<T> *out_;
+        ~finisher() { out_->done_.set(); }
+    };
+
+    template<class T, class Reduce>
+    void fold_finished(std::deque<partial<T>>& partials, T& init, Reduce& reduce) {
+        while (!partials.empty() && partials.front().done_.is_set()) {
+            if (partials.front().value_) {
+                init = std::invoke(reduce, std::move(init), std::move(*partials.front().value_));
+            }
+            partials.pop_front();
+        }
+    }
+
+    // Folds what it can, then waits for the oldest chunk until fewer than
+    // parallel_batches_in_flight results are held.
+    template<class T, class Reduce>
+    task<void> make_room(std::deque<partial<T>>& partials, T& init, Reduce& reduce) {
+        fold_finished(partials, init, reduce);
+        while (partials.size() >= parallel_batches_in_flight) {
+            co_await partials.front().done_;
+            fold_finished(partials, init, reduce);
+        }
+    }
+
+    template<class It, class F>
+    task<void> for_each_chunk(It first, size_t lo, size_t hi, F& f, async_semaphore& inFlight) {
+        permit p{&inFlight};
+        for (size_t i = lo; i < hi; ++i) {
+            std::invoke(f, first[i]);
+        }
+        co_return;
+    }
+
+    template<class T, class It, class Reduce, class Transform>
+    task<void> transform_reduce_chunk(It first, size_t lo, size_t hi, Reduce& reduce, Transform& transform, partial<T>& out, async_semaphore& inFlight) {
+        permit p{&inFlight};
+        finisher<T> f{&out};
+        out.value_.emplace(reduce_chunk<T>(first, lo, hi, reduce, transform));
+        co_return;
+    }
+
+    template<class V, class F>
+    task<void> for_each_batch(std::vector<V> batch, F& f, async_semaphore& inFlight) {
+        permit p{&inFlight};
+        for (V& v : batch) {
+            std::invoke(f, v);
+        }
+        co_return;
+    }
+
+    template<class T, class V, class Reduce, class Transform>
+    task<void> transform_reduce_batch(std::vector<V> batch, Reduce& reduce, Transform& transform, partial<T>& out, async_semaphore& inFlight) {
+        permit p{&inFlight};
+        finisher<T> f{&out};
+        out.value_.emplace(reduce_chunk<T>(batch.begin(), 0, batch.size(), reduce, transform));
+        co_return;
+    }
+
+    // Pulls the input range in batches of chunk elements, and spawns
+    // makeWork(batch) on ex for each, once makeRoom() is done.
+    template<class Ex, class R, class MakeRoom, class MakeWork>
+    task<void> pull_batches(Ex ex, R& range, size_t chunk, async_semaphore& inFlight, async_scope& scope, MakeRoom makeRoom, MakeWork makeWork) {
+        std::vector<std::ranges::range_value_t<R>> batch;
+        for (auto&& v : range) {
+            batch.emplace_back(static_cast<decltype(v)&&>(v));
+            if (batch.size() == chunk) {
+                co_await makeRoom();
+                co_await inFlight.acquire();
+                scope.spawn(ex, makeWork(std::exchange(batch, {})));
+            }
+        }
+        if (!batch.empty()) {
+            co_await makeRoom();
+            co_await inFlight.acquire();
+            scope.spawn(ex, makeWork(std::move(batch)));
+        }
+    }
+}
+
+template<Executor Ex, std::ranges::random_access_range R, class F>
+task<void> parallel_for_each(Ex ex, R&& range, size_t chunk, F f)
+{
+    chunk = std::max<size_t>(chunk, 1);
+    auto first = std::ranges::begin(range);
+    size_t n = std::ranges::distance(range);
+    async_semaphore inFlight(parallel_batches_in_flight);
+    async_scope scope;
+    std::exception_ptr error;
+    try {
+        for (size_t lo = 0; lo < n; lo += chunk) {
+            co_await inFlight.acquire();
+            scope.spawn(ex, parallel_detail::for_each_chunk(first, lo, std::min(n, lo + chunk), f, inFlight));
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    co_await scope.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template<Executor Ex, std::ranges::input_range R, class F>
+    requires (!std::ranges::random_access_range<R>)
+task<void> parallel_for_each(Ex ex, R&& range, size_t chunk, F f)
+{
+    using V = std::ranges::range_value_t<R>;
+    async_semaphore inFlight(parallel_batches_in_flight);
+    async_scope scope;
+    std::exception_ptr error;
+    try {
+        co_await parallel_detail::pull_batches(ex, range, std::max<size_t>(chunk, 1), inFlight, scope,
+            [] { return std::suspend_never(); },
+            [&](std::vector<V> batch) {
+                return parallel_detail::for_each_batch(std::move(batch), f, inFlight);
+            });
+    } catch (...) {
+        error = std::current_exception();
+    }
+    co_await scope.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+template<Executor Ex, std::ranges::random_access_range R, class T, class Reduce, class Transform>
+task<T> parallel_transform_reduce(Ex ex, R&& range, size_t chunk, T init, Reduce reduce, Transform transform)
+{
+    chunk = std::max<size_t>(chunk, 1);
+    auto first = std::ranges::begin(range);
+    size_t n = std::ranges::distance(range);
+    std::deque<parallel_detail::partial<T>> partials;
+    async_semaphore inFlight(parallel_batches_in_flight);
+    async_scope scope;
+    std::exception_ptr error;
+    try {
+        for (size_t lo = 0; lo < n; lo += chunk) {
+            co_await parallel_detail::make_room(partials, init, reduce);
+            co_await inFlight.acquire();
+            scope.spawn(ex, parallel_detail::transform_reduce_chunk<T>(
+                first, lo, std::min(n, lo + chunk), reduce, transform, partials.emplace_back(), inFlight
+            ));
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+    co_await scope.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    parallel_detail::fold_finished(partials, init, reduce);
+    co_return init;
+}
+
+template<Executor Ex, std::ranges::input_range R, class T, class Reduce, class Transform>
+    requires (!std::ranges::random_access_range<R>)
+task<T> parallel_transform_reduce(Ex ex, R&& range, size_t chunk, T init, Reduce reduce, Transform transform)
+{
+    using V = std::ranges::range_value_t<R>;
+    std::deque<parallel_detail::partial<T>> partials;  // grows without moving what workers write to
+    async_semaphore inFlight(parallel_batches_in_flight);
+    async_scope scope;
+    std::exception_ptr error;
+    try {
+        co_await parallel_detail::pull_batches(ex, range, std::max<size_t>(chunk, 1), inFlight, scope,
+            [&] { return parallel_detail::make_room(partials, init, reduce); },
+            [&](std::vector<V> batch) {
+                return parallel_detail::transform_reduce_batch<T>(std::move(batch), reduce, transform, partials.emplace_back(), inFlight);
+            });
+    } catch (...) {
+        error = std::current_exception();
+    }
+    co_await scope.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    parallel_detail::fold_finished(partials, init, reduce);
+    co_return init;
+}
+
+#endif // INCLUDED_CORO_PARALLEL_ALGORITHMS_H
@@ -0,0 +1,187 @@
+#ifndef INCLUDED_CORO_READ_AHEAD_H
+#define INCLUDED_CORO_READ_AHEAD_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "async_generator.h"
+#include "async_manual_reset_event.h"
+#include "concepts.h"
+#include "task.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// read_ahead(ex, path, chunkSize, buffers, openFlags) is an async_generator
+// that yields a file's contents as consecutive std::span<const std::byte>
+// chunks of chunkSize bytes (the last one shorter), reading ahead on the
+// executor ex while the consumer works on the chunk it has.
+//
+// It owns a fixed ring of buffers (two by default: double buffering), each
+// filled by a blocking pread() on ex. A chunk's buffer goes back to be
+// refilled as soon as the consumer asks for the next chunk, so memory stays
+// at buffers * chunkSize however large the file. The consumer resumes on
+// whichever of ex's threads finished the read it was waiting for. ex is
+// best a small work_stealing_pool set aside for blocking I/O; on a
+// new_thread_context, every chunk costs a thread.
+//
+// openFlags are added to O_RDONLY | O_CLOEXEC. The buffers are aligned to
+// read_ahead_alignment, so that O_DIRECT, which bypasses the page cache and
+// the kernel's own readahead, works on any file system; with O_DIRECT,
+// chunkSize must be a multiple of read_ahead_alignment.
+//
+// A chunkSize or buffers of zero (or a chunkSize that O_DIRECT can't use)
+// throws std::invalid_argument from read_ahead() itself. A file that can't
+// be opened, or a failed read, throws std::system_error from the consumer's
+// co_await, and so does whatever ex.schedule() throws when it can't
+// schedule a read (new_thread_context failing to start a thread). Reads still in flight when the generator
+// is destroyed finish into buffers they share ownership of; ex's context
+// must outlive them, as it must any work scheduled on it.
+
+inline constexpr size_t read_ahead_alignment = 4096;
+
+namespace read_ahead_detail {
+    struct aligned_delete {
+        void operator()(std::byte *p) const noexcept {
+            ::operator delete[](p, std::align_val_t(read_ahead_alignment));
+        }
+    };
+
+    struct buffer {
+        std::unique_ptr<std::byte[], aligned_delete> data_;
+        size_t size_ = 0;
+        int error_ = 0;
+        std::exception_ptr scheduleError_;
+        async_manual_reset_event ready_;
+    };
+
+    // Owns an open file, from the moment open() returns it.
+    class file_descriptor {
+    public:
+        explicit file_descriptor(int fd) noexcept : fd_(fd) {}
+        file_descriptor(file_descriptor&& rhs) noexcept : fd_(std::exchange(rhs.fd_, -1)) {}
+        file_descriptor& operator=(file_descriptor&&) = delete;
+
+        ~file_descriptor() {
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+        }
+
+        int get() const noexcept { return fd_; }
+
+    private:
+        int fd_;
+    };
+
+    struct file_state {
+        explicit file_state(file_descriptor fd, size_t chunkSize, size_t buffers) :
+            fd_(std::move(fd)),
+            chunkSize_(chunkSize),
+            buffers_(std::make_unique<buffer[]>(buffers))
+        {
+            for (size_t i = 0; i < buffers; ++i) {
+                buffers_[i].data_.reset(new (std::align_val_t(read_ahead_alignment)) std::byte[chunkSize]);
+            }
+        }
+
+        file_descriptor fd_;
+        size_t chunkSize_;
+        std::unique_ptr<buffer[]> buffers_;
+    };
+
+    template<class Ex>
+    task_detail::detached_task fill(Ex ex, std::shared_ptr<file_state> file, buffer *b, off_t offset) {
+        try {
+            co_await ex.schedule();
+        } catch (...) {
+            b->scheduleError_ = std::current_exception();
+            b->ready_.set();
+            co_return;
+        }
+        size_t n = 0;
+        int error = 0;
+        while (n < file->chunkSize_) {
+            ssize_t r = ::pread(file->fd_.get(), b->data_.get() + n, file->chunkSize_ - n, offset + n);
+            if (r > 0) {
+                n += r;
+            } else if (r == 0) {
+                break;
+            } else if (errno != EINTR) {
+                error = errno;
+                break;
+            }
+        }
+        b->size_ = n;
+        b->error_ = error;
+        b->ready_.set();
+    }
+
+    template<class Ex>
+    async_generator<std::span<const std::byte>> read_chunks(Ex ex, std::string path, size_t chunkSize, size_t buffers, int openFlags) {
+        file_descriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC | openFlags));
+        if (fd.get() < 0) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        auto file = std::make_shared<file_state>(std::move(fd), chunkSize, buffers);
+
+        off_t next = 0;
+        for (size_t i = 0; i < buffers; ++i, next += chunkSize) {
+            fill(ex, file, &file->buffers_[i], next);
+        }
+        for (size_t i = 0; true; i = (i + 1) % buffers, next += chunkSize) {
+            buffer& b = file->buffers_[i];
+            co_await b.ready_;
+            if (b.scheduleError_) {
+                std::rethrow_exception(b.scheduleError_);
+            }
+            if (b.error_ != 0) {
+                throw std::system_error(b.error_, std::generic_category(), path);
+            }
+            if (b.size_ != 0) {
+                co_yield std::span<const std::byte>(b.data_.get(), b.size_);
+            }
+            if (b.size_ < chunkSize) {
+                break;
+            }
+            b.ready_.reset();
+            fill(ex, file, &b, next);
+        }
+    }
+}
+
+template<Executor Ex>
+async_generator<std::span<const std::byte>> read_ahead(Ex ex, std::string path, size_t chunkSize = 1 << 20, size_t buffers = 2, int openFlags = 0)
+{
+    if (chunkSize == 0 || buffers == 0) {
+        throw std::invalid_argument("read_ahead: chunkSize and buffers must be nonzero");
+    }
+#ifdef O_DIRECT
+    if ((openFlags & O_DIRECT) && chunkSize % read_ahead_alignment != 0) {
+        throw std::invalid_argument("read_ahead: with O_DIRECT, chunkSize must be a multiple of read_ahead_alignment");
+    }
+#endif
+    return read_ahead_detail::read_chunks(std::move(ex), std::move(path), chunkSize, buffers, openFlags);
+}
+
+#endif // INCLUDED_CORO_READ_AHEAD_H
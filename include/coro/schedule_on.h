@@ -0,0 +1,108 @@
+#ifndef INCLUDED_CORO_SCHEDULE_ON_H
+#define INCLUDED_CORO_SCHEDULE_ON_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "concepts.h"
+#include "task.h"
+
+#include <type_traits>
+#include <utility>
+
+// Control over which executor a task, and whoever awaits it, runs on.
+//
+// co_await schedule_on(ex, t) runs t on ex; the awaiter resumes wherever t finishes.
+// co_await resume_on(ex, t) runs t wherever it runs, and then resumes the
+// awaiter on ex.
+// co_await home_on(ex), in a task, moves the task to ex and makes ex its
+// home executor: from then on, every task it co_awaits that finishes
+// anywhere else sends it back to ex, as if awaited through resume_on.
+//
+// In all three, a hop to an executor that's already running the current
+// thread (by its running_in_this_thread()) is skipped: the coroutine just
+// keeps going. Executors without running_in_this_thread() always hop.
+// schedule_on and resume_on each wrap t in a task of their own; home_on
+// allocates the task's home once, and sending a task home allocates
+// nothing. If the home executor fails to schedule it, the co_await that was
+// to come home throws that exception instead, wherever the awaited task
+// finished.
+
+template<Executor Ex, class T, class E>
+task<T, E> schedule_on(Ex ex, task<T, E> t)
+{
+    if (!task_detail::running_on(ex)) {
+        co_await ex.schedule();
+    }
+    co_return co_await std::move(t);
+}
+
+template<Executor Ex, class T, class E>
+task<T, E> resume_on(Ex ex, task<T, E> t)
+{
+    co_await t.when_ready();
+    if (!task_detail::running_on(ex)) {
+        co_await ex.schedule();
+    }
+    if constexpr (!std::is_void_v<E>) {
+        if (t.failed()) {
+            co_await error(std::move(t.error()));
+        }
+    }
+    co_return t.get();
+}
+
+template<Executor Ex>
+class home_on_awaiter {
+public:
+    explicit home_on_awaiter(Ex ex) : ex_(std::move(ex)), schedule_(ex_.schedule()) {}
+
+    bool await_ready() noexcept { return false; }
+
+    template<class P>
+    std::coroutine_handle<void> await_suspend(std::coroutine_handle<P> h) {
+        static_assert(std::is_base_of_v<task_detail::home_base, P>, "only a task has a home executor");
+        h.promise().own_env(h.address()).home_ = any_executor(ex_);
+        if (task_detail::running_on(ex_)) {
+            return h;
+        }
+        hopped_ = true;
+        using R = decltype(schedule_.await_suspend(h));
+        if constexpr (std::is_void_v<R>) {
+            schedule_.await_suspend(h);
+            return std::noop_coroutine();
+        } else if constexpr (std::is_same_v<R, bool>) {
+            return schedule_.await_suspend(h) ? std::noop_coroutine() : std::coroutine_handle<void>(h);
+        } else {
+            return schedule_.await_suspend(h);
+        }
+    }
+
+    void await_resume() {
+        if (hopped_) {
+            schedule_.await_resume();
+        }
+    }
+
+private:
+    Ex ex_;
+    decltype(std::declval<Ex&>().schedule()) schedule_;
+    bool hopped_ = false;
+};
+
+template<Executor Ex>
+home_on_awaiter<Ex> home_on(Ex ex)
+{
+    return home_on_awaiter<Ex>(std::move(ex));
+}
+
+#endif // INCLUDED_CORO_SCHEDULE_ON_H
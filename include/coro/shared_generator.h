@@ -18,9 +18,14 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
+#ifdef CORO_FRAME_PROFILE
+#include "frame_profile.h"
+#endif
+
 #include <atomic>
 #include <iterator>
 #include <memory>
+#include <utility>
 
 #ifndef INCLUDED_CORO_MANUAL_LIFETIME_H
 #define INCLUDED_CORO_MANUAL_LIFETIME_H
@@ -89,7 +94,11 @@ struct manual_lifetime<void> {
 template<class Ref, class Value = std::decay_t<Ref>>
 class shared_generator {
 public:
-    class promise_type {
+    class promise_type
+#ifdef CORO_FRAME_PROFILE
+        : public frame_profiled<promise_type>
+#endif
+    {
     public:
         promise_type() noexcept {}
 
@@ -163,6 +172,7 @@ public:
     // ViewableRange refines Semiregular refines Copyable
     shared_generator& operator=(shared_generator g) noexcept {
         this->swap(g);
+        return *this;
     }
 
     void swap(shared_generator& g) noexcept {
@@ -16,13 +16,59 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
+#ifdef CORO_TRACE
+#include "trace.h"
+#elif !defined(INCLUDED_CORO_TRACE_HOOKS)
+#define INCLUDED_CORO_TRACE_HOOKS
+// trace.h's hooks, which do nothing without -DCORO_TRACE.
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // CORO_TRACE
+
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <exception>
 #include <mutex>
 #include <utility>
 
+// sync_wait(t) blocks the calling thread until the awaitable t completes.
+// Blocking one of an execution context's own threads, though, idles it, and
+// if the work t is waiting for is queued behind it, deadlocks it. So a
+// context can install a sync_wait_helper on each of its threads (as
+// work_stealing_pool does on its workers): sync_wait there runs the
+// context's queued work, one piece at a time, until t completes, and
+// between pieces, when there's none, sleeps only briefly.
+//
+// Whatever work the helper picks up runs to its next suspension on top of
+// the waiting sync_wait's stack; if that work itself waits for something
+// the outer sync_wait's caller has yet to do, it deadlocks all the same.
+
+struct sync_wait_helper {
+    bool (*runOne_)(void *context);  // runs one piece of work; false if there was none
+    void *context_;
+
+    static inline thread_local sync_wait_helper *current_ = nullptr;
+};
+
 struct sync_wait_task {
     struct promise_type {
+        promise_type() noexcept {
+            trace_promise(trace_event::create, "sync_wait", *this);
+        }
+
+        ~promise_type() {
+            trace_promise(trace_event::destroy, "sync_wait", *this);
+        }
+
         sync_wait_task get_return_object() noexcept {
             return sync_wait_task(
                 std::coroutine_handle<promise_type>::from_promise(*this)
@@ -30,19 +76,20 @@ struct sync_wait_task {
         }
 
         auto initial_suspend() {
-            return std::experimental::suspend_always{};
+            return std::suspend_always{};
         }
 
         auto final_suspend() noexcept {
             struct awaiter {
-                bool await_ready() { return false; }
-                void await_suspend(std::coroutine_handle<promise_type> h) {
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    trace_emit(trace_event::complete, "sync_wait", h.address());
                     auto& promise = h.promise();
                     std::lock_guard<std::mutex> lock(promise.mut_);
-                    promise.done_ = true;
+                    promise.done_.store(true, std::memory_order_release);
                     promise.cv_.notify_one();
                 }
-                void await_resume() {}
+                void await_resume() noexcept {}
             };
             return awaiter{};
         }
@@ -54,8 +101,18 @@ struct sync_wait_task {
         }
 
         void wait() {
+            if (sync_wait_helper *helper = sync_wait_helper::current_) {
+                while (!done_.load(std::memory_order_acquire)) {
+                    if (!helper->runOne_(helper->context_)) {
+                        std::unique_lock<std::mutex> lk(mut_);
+                        if (!done_.load(std::memory_order_relaxed)) {
+                            cv_.wait_for(lk, std::chrono::microseconds(100));
+                        }
+                    }
+                }
+            }
             std::unique_lock<std::mutex> lk(mut_);
-            while (!done_) {
+            while (!done_.load(std::memory_order_relaxed)) {
                 cv_.wait(lk);
             }
 
@@ -66,7 +123,7 @@ struct sync_wait_task {
     private:
         std::mutex mut_;
         std::condition_variable cv_;
-        bool done_ = false;
+        std::atomic<bool> done_{false};
         std::exception_ptr error_;
     };
 
@@ -85,8 +142,12 @@ struct sync_wait_task {
         }
     }
 
+    // The awaited task may finish on another thread; the slice here covers
+    // only the part that runs on this one.
     void wait() {
+        trace_emit(trace_event::resume, "sync_wait", coro_.address());
         coro_.resume();
+        trace_emit(trace_event::suspend, "sync_wait", coro_.address());
         coro_.promise().wait();
     }
 
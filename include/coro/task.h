@@ -17,8 +17,36 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
+#ifdef CORO_ASYNC_STACK
+#include "async_stack.h"
+#endif
+#include "any_executor.h"
+#ifdef CORO_FRAME_PROFILE
+#include "frame_profile.h"
+#endif
+#ifdef CORO_TRACE
+#include "trace.h"
+#elif !defined(INCLUDED_CORO_TRACE_HOOKS)
+#define INCLUDED_CORO_TRACE_HOOKS
+// trace.h's hooks, which do nothing without -DCORO_TRACE.
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // CORO_TRACE
+
+#include <cstdint>
 #include <exception>
 #include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
 #include <utility>
 
 #ifndef INCLUDED_CORO_MANUAL_LIFETIME_H
@@ -85,29 +113,442 @@ struct manual_lifetime<void> {
 
 #endif // INCLUDED_CORO_MANUAL_LIFETIME_H
 
-template<class T>
+// task<T, E> is a task<T> that can also complete with an error value of
+// type E, with no exception involved: co_return error(e), or co_await error(e)
+// (which also works in a task<void, E>). A task<U, E2> awaiting it, where
+// E2 is constructible from E, never sees the error: the awaiting task is
+// skipped too, completing with the error converted to E2, and so on up the
+// chain. Anything else awaiting it gets a thrown task_error<E>, unless it
+// does co_await t.when_ready() and then asks t.failed() before t.get().
+
+template<class T, class E = void>
 class task;
 
+template<class E>
+class task_error {
+public:
+    explicit task_error(E e) : error_(std::move(e)) {}
+
+    E& error() & noexcept { return error_; }
+    const E& error() const& noexcept { return error_; }
+    E&& error() && noexcept { return std::move(error_); }
+
+    bool await_ready() noexcept { return false; }
+
+    template<class P, class = typename P::task_error_type>
+    std::coroutine_handle<void> await_suspend(std::coroutine_handle<P> h) {
+        h.promise().fail(std::move(error_));
+        return h.promise().finish();
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    E error_;
+};
+
+template<class E>
+task_error<std::decay_t<E>> error(E&& e) {
+    return task_error<std::decay_t<E>>(static_cast<E&&>(e));
+}
+
+namespace task_detail {
+    template<class T, class Promise>
+    struct return_value_or_error {
+        template<
+            class U,
+            std::enable_if_t<std::is_convertible_v<U, T>, int> = 0>
+        void return_value(U&& value) {
+            static_cast<Promise*>(this)->set_value((U&&)value);
+        }
+
+        template<class G>
+        void return_value(task_error<G> e) {
+            static_cast<Promise*>(this)->fail(std::move(e).error());
+        }
+    };
+
+    template<class Promise>
+    struct return_value_or_error<void, Promise> {
+        void return_void() {
+            static_cast<Promise*>(this)->set_value();
+        }
+    };
+
+    // With -DCORO_ASYNC_STACK, every task_promise is an async_stack_frame.
+#ifdef CORO_ASYNC_STACK
+    using frame_base = async_stack_frame;
+#else
+    struct frame_base {
+        void on_await(void *) noexcept {}
+        void on_awaited(frame_base *) noexcept {}
+        void on_finish() noexcept {}
+    };
+#endif
+
+    template<class P>
+    frame_base *frame_of(std::coroutine_handle<P> h) noexcept {
+        if constexpr (std::is_base_of_v<frame_base, P>) {
+            return &h.promise();
+        } else {
+            return nullptr;
+        }
+    }
+
+    template<class Ex>
+    bool running_on(const Ex& ex) noexcept {
+        if constexpr (requires { ex.running_in_this_thread(); }) {
+            return ex.running_in_this_thread();
+        } else {
+            return false;
+        }
+    }
+
+    struct detached_task {
+        struct promise_type {
+            detached_task get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    // What a task hands down to the tasks it awaits, once it has a home
+    // executor (see home_on() in schedule_on.h) or a stop token of its own
+    // (see with_timeout.h). Its owner is the frame that set it up; outer_
+    // is what the owner itself inherited. hop_ is the home executor's
+    // schedule() awaiter while a task the owner awaited is sending it home.
+    struct task_env {
+        any_executor home_{};
+        const std::stop_token *stopToken_ = nullptr;
+        const task_env *outer_ = nullptr;
+        const void *owner_ = nullptr;
+        mutable std::optional<any_executor::schedule_awaitable> hop_{};
+    };
+
+    // What a task_promise holds; failure is only for a task<T, E>.
+    enum class task_state { empty, value, error, failure };
+
+    // Every task_promise is a home_base: one word holding a pointer to the
+    // task_env it runs in (which most tasks just inherit from their
+    // awaiter), whether that task_env is the task's own, and the promise's
+    // task_state. So a plain task's frame is no bigger for it, and all it
+    // costs is a store when it's awaited and a compare at final_suspend.
+    // A task whose awaiter has a home executor goes back there to resume
+    // it, unless it finishes there anyway, by way of the awaiter kept in
+    // the awaiter's task_env, so the hop allocates nothing; a task with no
+    // awaiter, or one that isn't a task, has no task_env at all.
+    class home_base {
+    public:
+        home_base() noexcept = default;
+        home_base(const home_base&) = delete;
+        home_base& operator=(const home_base&) = delete;
+
+        ~home_base() {
+            if (word_ & owned) {
+                delete env();
+            }
+        }
+
+        const task_env *env() const noexcept {
+            return reinterpret_cast<const task_env*>(word_ & ~(owned | state_mask));
+        }
+
+        task_state state() const noexcept {
+            return task_state((word_ & state_mask) >> 1);
+        }
+
+        void set_state(task_state s) noexcept {
+            word_ = (word_ & ~state_mask) | (uintptr_t(s) << 1);
+        }
+
+        task_state exchange_state(task_state s) noexcept {
+            task_state old = state();
+            set_state(s);
+            return old;
+        }
+
+        template<class P>
+        void set_awaiter(std::coroutine_handle<P> h) noexcept {
+            if constexpr (std::is_base_of_v<home_base, P>) {
+                set_env(static_cast<home_base&>(h.promise()).env(), 0);
+            }
+        }
+
+        // The task_env this task (whose frame is self) hands down from now
+        // on, allocated the first time it's asked for.
+        task_env& own_env(const void *self) {
+            if (!(word_ & owned)) {
+                task_env *e = new task_env;
+                e->outer_ = env();
+                e->owner_ = self;
+                e->stopToken_ = e->outer_ ? e->outer_->stopToken_ : nullptr;
+                set_env(e, owned);
+            }
+            return *const_cast<task_env*>(env());
+        }
+
+        // For a task (whose frame is self) without a task_env of its own:
+        // hands e, which lives in that frame, down instead, until pop_env(e).
+        void push_env(task_env& e, const void *self) noexcept {
+            e.outer_ = env();
+            e.owner_ = self;
+            if (e.stopToken_ == nullptr && e.outer_ != nullptr) {
+                e.stopToken_ = e.outer_->stopToken_;
+            }
+            set_env(&e, 0);
+        }
+
+        void pop_env(task_env& e) noexcept {
+            set_env(e.outer_, 0);
+        }
+
+        // Where this task (whose frame is self) resumes its continuation:
+        // inline, or by scheduling it on its home executor. If scheduling
+        // throws, the continuation hasn't been handed off. Once it has,
+        // only locals are safe to touch.
+        std::coroutine_handle<void> go_home(const void *self, std::coroutine_handle<void> continuation) {
+            const task_env *e = awaiter_env(self);
+            if (e == nullptr || e->owner_ != continuation.address() || !e->home_ || e->home_.running_in_this_thread()) {
+                return continuation;
+            }
+            try {
+                e->hop_.emplace(e->home_.schedule());
+                return e->hop_->await_suspend(continuation);
+            } catch (...) {
+                e->hop_.reset();
+                throw;
+            }
+        }
+
+        // Called by the continuation once it's resumed: finishes the hop
+        // that go_home() started, if it started one.
+        void came_home(const void *self) {
+            const task_env *e = awaiter_env(self);
+            if (e != nullptr && e->hop_) {
+                e->hop_->await_resume();
+                e->hop_.reset();
+            }
+        }
+
+    private:
+        // The task_env this task's awaiter hands down.
+        const task_env *awaiter_env(const void *self) const noexcept {
+            const task_env *e = env();
+            if (e != nullptr && e->owner_ == self) {
+                e = e->outer_;
+            }
+            return e;
+        }
+
+        static constexpr uintptr_t owned = 1;  // the task_env is this task's, on the heap
+        static constexpr uintptr_t state_mask = 6;
+        static_assert(alignof(task_env) >= 8);
+
+        void set_env(const task_env *e, uintptr_t flags) noexcept {
+            word_ = reinterpret_cast<uintptr_t>(e) | flags | (word_ & state_mask);
+        }
+
+        uintptr_t word_ = 0;
+    };
+
+    static_assert(sizeof(home_base) == sizeof(uintptr_t));
+
+    struct stop_token_awaiter {
+        std::stop_token token_;
+
+        bool await_ready() noexcept { return false; }
+
+        template<class P>
+        bool await_suspend(std::coroutine_handle<P> h) noexcept {
+            const task_env *e = static_cast<home_base&>(h.promise()).env();
+            if (e != nullptr && e->stopToken_ != nullptr) {
+                token_ = *e->stopToken_;
+            }
+            return false;
+        }
+
+        std::stop_token await_resume() noexcept { return std::move(token_); }
+    };
+
+    // Whether a coroutine whose promise is P can take over a task<T, E>'s error.
+    template<class P, class E, class = void>
+    struct can_propagate : std::false_type {};
+
+    template<class P, class E>
+    struct can_propagate<P, E, std::void_t<typename P::task_error_type>> :
+        std::bool_constant<!std::is_void_v<E> && std::is_constructible_v<typename P::task_error_type, E>> {};
+}
+
+// co_await get_stop_token() in a task returns the stop token it inherited
+// from the tasks awaiting it (see with_timeout.h); a task that should stop
+// early when asked checks it. Without one, the token is never stopped.
+inline task_detail::stop_token_awaiter get_stop_token() noexcept {
+    return {};
+}
+
+template<class T, class E = void>
+class task_promise :
+    public task_detail::frame_base,
+#ifdef CORO_FRAME_PROFILE
+    public frame_profiled<task_promise<T, E>>,
+#endif
+    public task_detail::home_base,
+    public task_detail::return_value_or_error<T, task_promise<T, E>>
+{
+public:
+    using task_error_type = E;
+
+    task_promise() noexcept {
+        trace_promise(trace_event::create, "task", *this);
+    }
+
+    ~task_promise() {
+        trace_promise(trace_event::destroy, "task", *this);
+        clear();
+    }
+
+    task<T, E> get_return_object() noexcept;
+
+    auto initial_suspend() {
+        return trace_initial_suspend("task", std::coroutine_handle<task_promise>::from_promise(*this).address());
+    }
+
+#if defined(CORO_ASYNC_STACK) || defined(CORO_TRACE)
+    template<class A>
+    [[gnu::noinline]] decltype(auto) await_transform(A&& a) {
+        this->on_await(__builtin_return_address(0));
+        return trace_await("task", static_cast<A&&>(a));
+    }
+#endif
+
+    auto final_suspend() noexcept {
+        struct awaiter {
+            bool await_ready() noexcept { return false; }
+            auto await_suspend(std::coroutine_handle<task_promise> h) noexcept {
+                trace_emit(trace_event::complete, "task", h.address());
+                trace_emit(trace_event::suspend, "task", h.address());
+                return h.promise().finish();
+            }
+            void await_resume() noexcept {}
+        };
+        return awaiter{};
+    }
+
+    void unhandled_exception() noexcept {
+        clear();
+        error_.construct(std::current_exception());
+        this->set_state(state_t::error);
+    }
+
+    T get() {
+        if (this->state() == state_t::error) {
+            std::rethrow_exception(std::move(error_).get());
+        } else if (this->state() == state_t::failure) {
+            throw task_error<E>(std::move(failure_).get());
+        }
+        return std::move(value_).get();
+    }
+
+    template<class... Args>
+    void set_value(Args&&... args) {
+        clear();
+        value_.construct((Args&&)args...);
+        this->set_state(state_t::value);
+    }
+
+    template<class G>
+    void fail(G&& e) {
+        clear();
+        failure_.construct((G&&)e);
+        this->set_state(state_t::failure);
+    }
+
+    // Where to go once this task is done: its continuation (by way of its
+    // awaiter's home executor), unless it failed and its awaiter can take
+    // over the error. If the hop home fails, the continuation resumes here
+    // and gets the hop's exception instead of the result.
+    std::coroutine_handle<void> finish() noexcept {
+        this->on_finish();
+        if (this->state() == state_t::failure && propagate_ != nullptr) {
+            return propagate_(continuation_, *this);
+        }
+        try {
+            return this->go_home(std::coroutine_handle<task_promise>::from_promise(*this).address(), continuation_);
+        } catch (...) {
+            unhandled_exception();
+            return continuation_;
+        }
+    }
+
+private:
+    friend class task<T, E>;
+
+    void clear() noexcept {
+        switch (this->exchange_state(state_t::empty)) {
+        case state_t::empty: break;
+        case state_t::error: error_.destruct(); break;
+        case state_t::value: value_.destruct(); break;
+        case state_t::failure: failure_.destruct(); break;
+        }
+    }
+
+    std::coroutine_handle<void> continuation_;
+    std::coroutine_handle<void> (*propagate_)(std::coroutine_handle<void>, task_promise&) = nullptr;
+    using state_t = task_detail::task_state;
+    union {
+        manual_lifetime<T> value_;
+        manual_lifetime<std::exception_ptr> error_;
+        manual_lifetime<E> failure_;
+    };
+};
+
 template<class T>
-class task_promise {
+class task_promise<T, void> :
+    public task_detail::frame_base,
+#ifdef CORO_FRAME_PROFILE
+    public frame_profiled<task_promise<T, void>>,
+#endif
+    public task_detail::home_base
+{
 public:
-    task_promise() noexcept {}
+    task_promise() noexcept {
+        trace_promise(trace_event::create, "task", *this);
+    }
 
     ~task_promise() {
+        trace_promise(trace_event::destroy, "task", *this);
         clear();
     }
 
     task<T> get_return_object() noexcept;
 
-    std::suspend_always initial_suspend() {
-        return {};
+    auto initial_suspend() {
+        return trace_initial_suspend("task", std::coroutine_handle<task_promise>::from_promise(*this).address());
+    }
+
+#if defined(CORO_ASYNC_STACK) || defined(CORO_TRACE)
+    template<class A>
+    [[gnu::noinline]] decltype(auto) await_transform(A&& a) {
+        this->on_await(__builtin_return_address(0));
+        return trace_await("task", static_cast<A&&>(a));
     }
+#endif
 
     auto final_suspend() noexcept {
         struct awaiter {
             bool await_ready() noexcept { return false; }
             auto await_suspend(std::coroutine_handle<task_promise> h) noexcept {
-                return h.promise().continuation_;
+                trace_emit(trace_event::complete, "task", h.address());
+                trace_emit(trace_event::suspend, "task", h.address());
+                h.promise().on_finish();
+                try {
+                    return h.promise().go_home(h.address(), h.promise().continuation_);
+                } catch (...) {
+                    h.promise().unhandled_exception();
+                    return h.promise().continuation_;
+                }
             }
             void await_resume() noexcept {}
         };
@@ -120,17 +561,17 @@ public:
     void return_value(U&& value) {
         clear();
         value_.construct((U&&)value);
-        state_ = state_t::value;
+        this->set_state(state_t::value);
     }
 
     void unhandled_exception() noexcept {
         clear();
         error_.construct(std::current_exception());
-        state_ = state_t::error;
+        this->set_state(state_t::error);
     }
 
     T get() {
-        if (state_ == state_t::error) {
+        if (this->state() == state_t::error) {
             std::rethrow_exception(std::move(error_).get());
         }
         return std::move(value_).get();
@@ -140,16 +581,16 @@ private:
     friend class task<T>;
 
     void clear() noexcept {
-        switch (std::exchange(state_, state_t::empty)) {
+        switch (this->exchange_state(state_t::empty)) {
         case state_t::empty: break;
         case state_t::error: error_.destruct(); break;
         case state_t::value: value_.destruct(); break;
+        case state_t::failure: break;
         }
     }
 
     std::coroutine_handle<void> continuation_;
-    enum class state_t { empty, value, error };
-    state_t state_ = state_t::empty;
+    using state_t = task_detail::task_state;
     union {
         manual_lifetime<T> value_;
         manual_lifetime<std::exception_ptr> error_;
@@ -157,27 +598,52 @@ private:
 };
 
 template<>
-class task_promise<void> {
+class task_promise<void, void> :
+    public task_detail::frame_base,
+#ifdef CORO_FRAME_PROFILE
+    public frame_profiled<task_promise<void, void>>,
+#endif
+    public task_detail::home_base
+{
 public:
-    task_promise() noexcept {}
+    task_promise() noexcept {
+        trace_promise(trace_event::create, "task", *this);
+    }
 
     ~task_promise() {
+        trace_promise(trace_event::destroy, "task", *this);
         clear();
     }
 
     task<void> get_return_object() noexcept;
 
-    std::suspend_always initial_suspend() {
-        return {};
+    auto initial_suspend() {
+        return trace_initial_suspend("task", std::coroutine_handle<task_promise>::from_promise(*this).address());
+    }
+
+#if defined(CORO_ASYNC_STACK) || defined(CORO_TRACE)
+    template<class A>
+    [[gnu::noinline]] decltype(auto) await_transform(A&& a) {
+        this->on_await(__builtin_return_address(0));
+        return trace_await("task", static_cast<A&&>(a));
     }
+#endif
 
-    auto final_suspend() {
+    auto final_suspend() noexcept {
         struct awaiter {
-            bool await_ready() { return false; }
-            auto await_suspend(std::coroutine_handle<task_promise> h) {
-                return h.promise().continuation_;
+            bool await_ready() noexcept { return false; }
+            auto await_suspend(std::coroutine_handle<task_promise> h) noexcept {
+                trace_emit(trace_event::complete, "task", h.address());
+                trace_emit(trace_event::suspend, "task", h.address());
+                h.promise().on_finish();
+                try {
+                    return h.promise().go_home(h.address(), h.promise().continuation_);
+                } catch (...) {
+                    h.promise().unhandled_exception();
+                    return h.promise().continuation_;
+                }
             }
-            void await_resume() {}
+            void await_resume() noexcept {}
         };
         return awaiter{};
     }
@@ -185,17 +651,17 @@ public:
     void return_void() {
         clear();
         value_.construct();
-        state_ = state_t::value;
+        this->set_state(state_t::value);
     }
 
     void unhandled_exception() noexcept {
         clear();
         error_.construct(std::current_exception());
-        state_ = state_t::error;
+        this->set_state(state_t::error);
     }
 
     void get() {
-        if (state_ == state_t::error) {
+        if (this->state() == state_t::error) {
             std::rethrow_exception(std::move(error_).get());
         }
     }
@@ -204,27 +670,27 @@ private:
     friend class task<void>;
 
     void clear() noexcept {
-        switch (std::exchange(state_, state_t::empty)) {
+        switch (this->exchange_state(state_t::empty)) {
             case state_t::empty: break;
             case state_t::error: error_.destruct(); break;
             case state_t::value: value_.destruct(); break;
+            case state_t::failure: break;
         }
     }
 
-    enum class state_t { empty, value, error };
+    using state_t = task_detail::task_state;
 
     std::coroutine_handle<void> continuation_;
-    state_t state_ = state_t::empty;
     union {
         manual_lifetime<void> value_;
         manual_lifetime<std::exception_ptr> error_;
     };
 };
 
-template<class T>
+template<class T, class E>
 class task {
 public:
-    using promise_type = task_promise<T>;
+    using promise_type = task_promise<T, E>;
     using handle_t = std::coroutine_handle<promise_type>;
 
     explicit task(handle_t h) noexcept
@@ -241,39 +707,103 @@ public:
         }
     }
 
-    auto operator co_await() && noexcept {
-        struct awaiter {
-        public:
-            explicit awaiter(handle_t coro) : coro_(coro) {}
-            bool await_ready() noexcept {
-                return false;
-            }
-            auto await_suspend(std::coroutine_handle<void> h) noexcept {
-                coro_.promise().continuation_ = h;
-                return coro_;
-            }
-            T await_resume() {
-                return coro_.promise().get();
+private:
+    class awaiter {
+    public:
+        explicit awaiter(handle_t coro) : coro_(coro) {}
+        bool await_ready() noexcept {
+            return false;
+        }
+        template<class P>
+        auto await_suspend(std::coroutine_handle<P> h) noexcept {
+            coro_.promise().continuation_ = h;
+            coro_.promise().on_awaited(task_detail::frame_of(h));
+            coro_.promise().set_awaiter(h);
+            if constexpr (task_detail::can_propagate<P, E>::value) {
+                coro_.promise().propagate_ = &propagate<P>;
             }
-        private:
-            handle_t coro_;
-        };
+            return coro_;
+        }
+        T await_resume() {
+            coro_.promise().came_home(coro_.address());
+            return coro_.promise().get();
+        }
+    private:
+        handle_t coro_;
+    };
+
+    class ready_awaiter {
+    public:
+        explicit ready_awaiter(handle_t coro) : coro_(coro) {}
+        bool await_ready() noexcept {
+            return false;
+        }
+        template<class P>
+        auto await_suspend(std::coroutine_handle<P> h) noexcept {
+            coro_.promise().continuation_ = h;
+            coro_.promise().on_awaited(task_detail::frame_of(h));
+            coro_.promise().set_awaiter(h);
+            return coro_;
+        }
+        void await_resume() {
+            coro_.promise().came_home(coro_.address());
+        }
+    private:
+        handle_t coro_;
+    };
+
+    // Hands a failed child's error to the awaiting task, which is done too.
+    template<class P>
+    static std::coroutine_handle<void> propagate(std::coroutine_handle<void> parent, promise_type& child) {
+        P& p = std::coroutine_handle<P>::from_address(parent.address()).promise();
+        p.fail(std::move(child.failure_).get());
+        return p.finish();
+    }
+
+public:
+    auto operator co_await() && noexcept {
         return awaiter(coro_);
     }
 
+    // Runs the task to completion, without throwing.
+    ready_awaiter when_ready() noexcept {
+        return ready_awaiter(coro_);
+    }
+
+    // These three are for use after co_await when_ready().
+    bool failed() const noexcept {
+        return coro_.promise().state() == task_detail::task_state::failure;
+    }
+
+    std::add_lvalue_reference_t<E> error() noexcept {
+        return coro_.promise().failure_.get();
+    }
+
+    T get() {
+        return coro_.promise().get();
+    }
+
 private:
     handle_t coro_;
 };
 
+template<class T, class E>
+task<T, E> task_promise<T, E>::get_return_object() noexcept
+{
+    return task<T, E>(
+        std::coroutine_handle<task_promise<T, E>>::from_promise(*this)
+    );
+}
+
 template<class T>
-task<T> task_promise<T>::get_return_object() noexcept
+task<T> task_promise<T, void>::get_return_object() noexcept
 {
     return task<T>(
         std::coroutine_handle<task_promise<T>>::from_promise(*this)
     );
 }
 
-inline task<void> task_promise<void>::get_return_object() noexcept
+inline task<void> task_promise<void, void>::get_return_object() noexcept
 {
     return task<void>(
         std::coroutine_handle<task_promise<void>>::from_promise(*this)
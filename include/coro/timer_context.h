@@ -0,0 +1,285 @@
+#ifndef INCLUDED_CORO_TIMER_CONTEXT_H
+#define INCLUDED_CORO_TIMER_CONTEXT_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#ifdef CORO_TRACE
+#include "trace.h"
+#elif !defined(INCLUDED_CORO_TRACE_HOOKS)
+#define INCLUDED_CORO_TRACE_HOOKS
+// trace.h's hooks, which do nothing without -DCORO_TRACE.
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // CORO_TRACE
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// timer_context models ExecutionContext.
+// It owns a single thread that drives a hashed timing wheel, so that
+// arming a timer, or disarming it before it fires, is O(1) no matter how
+// many timers are pending.
+// Its .get_executor() method returns an Executor whose schedule_after()
+// and schedule_at() resume the awaiting coroutine on the timer thread
+// once the deadline has passed. Timers fire at tick granularity
+// (one millisecond by default), never early.
+//
+// Code resumed on the timer thread should be short; anything heavier
+// should hop to another executor first.
+
+class timer_context {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // A timer_node is an intrusive wheel entry. It lives in whatever object
+    // armed it (usually an awaiter in a coroutine frame), and must stay
+    // alive until fire_ has been called or disarm() has returned true.
+    struct timer_node {
+        clock::time_point deadline_;
+        void (*fire_)(timer_node *) = nullptr;
+        timer_node *prev_ = nullptr;
+        timer_node *next_ = nullptr;
+        uint64_t tick_ = 0;
+        bool armed_ = false;
+    };
+
+    explicit timer_context(clock::duration tick = std::chrono::milliseconds(1)) :
+        tick_(tick),
+        epoch_(clock::now()),
+        wheel_(wheelSize),
+        thread_([this]() { run(); })
+    {}
+
+    ~timer_context() {
+        std::unique_lock<std::mutex> lk(mut_);
+        draining_ = true;
+        while (pendingCount_ != 0 || firing_) {
+            cv_.wait(lk);
+        }
+        stopping_ = true;
+        cv_.notify_all();
+        lk.unlock();
+        thread_.join();
+    }
+
+    timer_context(const timer_context&) = delete;
+    timer_context& operator=(const timer_context&) = delete;
+
+    void arm(timer_node *node) {
+        std::lock_guard<std::mutex> lock(mut_);
+        node->tick_ = std::max(tick_of(node->deadline_), lastTick_ + 1);
+        timer_node *&slot = wheel_[node->tick_ % wheelSize];
+        node->prev_ = nullptr;
+        node->next_ = slot;
+        if (slot != nullptr) {
+            slot->prev_ = node;
+        }
+        slot = node;
+        node->armed_ = true;
+        ++pendingCount_;
+        // Otherwise the timer thread is already waiting for the next tick,
+        // which the node can't be due before.
+        if (idle_) {
+            cv_.notify_all();
+        }
+    }
+
+    // Takes an armed node off the wheel, in O(1), so that fire_ will never
+    // be called. Returns false if it's too late: the node is due, and fire_
+    // is about to be called or already has been.
+    bool disarm(timer_node *node) {
+        std::lock_guard<std::mutex> lock(mut_);
+        if (!node->armed_) {
+            return false;
+        }
+        unlink(node);
+        if (draining_ && pendingCount_ == 0) {
+            cv_.notify_all();
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t wheelSize = 1024;
+
+    class sleep_awaitable : private timer_node {
+    public:
+        explicit sleep_awaitable(timer_context *context, clock::time_point deadline) :
+            context_(context)
+        {
+            this->deadline_ = deadline;
+            this->fire_ = [](timer_node *node) {
+                std::coroutine_handle<void> h = static_cast<sleep_awaitable*>(node)->coro_;
+                trace_emit(trace_event::run_begin, "timer_context", h.address());
+                h.resume();
+                trace_emit(trace_event::run_end, "timer_context", h.address());
+            };
+        }
+
+        bool await_ready() { return false; }
+
+        void await_suspend(std::coroutine_handle<void> h) {
+            coro_ = h;
+            trace_emit(trace_event::schedule, "timer_context", h.address());
+            context_->arm(this);
+        }
+
+        void await_resume() {}
+
+    private:
+        timer_context *context_;
+        std::coroutine_handle<void> coro_;
+    };
+
+public:
+
+    struct executor {
+    public:
+        explicit executor(timer_context *context) noexcept :
+            context_(context)
+        {}
+
+        auto schedule() noexcept {
+            return sleep_awaitable(context_, clock::now());
+        }
+
+        auto schedule_at(clock::time_point deadline) noexcept {
+            return sleep_awaitable(context_, deadline);
+        }
+
+        template<class Rep, class Period>
+        auto schedule_after(std::chrono::duration<Rep, Period> delay) noexcept {
+            return sleep_awaitable(context_, clock::now() + std::chrono::ceil<clock::duration>(delay));
+        }
+
+        bool running_in_this_thread() const noexcept {
+            return context_->thread_.get_id() == std::this_thread::get_id();
+        }
+
+        timer_context *context() const noexcept { return context_; }
+
+    private:
+        timer_context *context_;
+    };
+
+    executor get_executor() { return executor(this); }
+
+private:
+    uint64_t tick_of(clock::time_point t) const {
+        if (t <= epoch_) {
+            return 0;
+        }
+        return (t - epoch_ + tick_ - clock::duration(1)) / tick_;
+    }
+
+    void unlink(timer_node *node) {
+        if (node->prev_ != nullptr) {
+            node->prev_->next_ = node->next_;
+        } else {
+            wheel_[node->tick_ % wheelSize] = node->next_;
+        }
+        if (node->next_ != nullptr) {
+            node->next_->prev_ = node->prev_;
+        }
+        node->armed_ = false;
+        --pendingCount_;
+    }
+
+    // Moves every node of the slot that is due by nowTick onto the due list.
+    void collect(size_t slot, uint64_t nowTick, timer_node *&due) {
+        timer_node *node = wheel_[slot];
+        while (node != nullptr) {
+            timer_node *next = node->next_;
+            if (node->tick_ <= nowTick) {
+                unlink(node);
+                node->next_ = due;
+                due = node;
+            }
+            node = next;
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lk(mut_);
+        while (true) {
+            if (pendingCount_ == 0) {
+                if (stopping_) {
+                    return;
+                }
+                idle_ = true;
+                cv_.wait(lk);
+                idle_ = false;
+                continue;
+            }
+            uint64_t nowTick = (clock::now() - epoch_) / tick_;
+            timer_node *due = nullptr;
+            if (nowTick - lastTick_ >= wheelSize) {
+                for (size_t slot = 0; slot < wheelSize; ++slot) {
+                    collect(slot, nowTick, due);
+                }
+            } else {
+                for (uint64_t t = lastTick_ + 1; t <= nowTick; ++t) {
+                    collect(t % wheelSize, nowTick, due);
+                }
+            }
+            if (nowTick > lastTick_) {
+                lastTick_ = nowTick;
+            }
+            if (due != nullptr) {
+                firing_ = true;
+                lk.unlock();
+                while (due != nullptr) {
+                    timer_node *next = due->next_;
+                    due->fire_(due);
+                    due = next;
+                }
+                lk.lock();
+                firing_ = false;
+                if (draining_) {
+                    cv_.notify_all();
+                }
+                continue;
+            }
+            cv_.wait_until(lk, epoch_ + tick_ * static_cast<clock::rep>(lastTick_ + 1));
+        }
+    }
+
+    clock::duration tick_;
+    clock::time_point epoch_;
+    std::mutex mut_;
+    std::condition_variable cv_;
+    std::vector<timer_node *> wheel_;
+    uint64_t lastTick_ = 0;
+    size_t pendingCount_ = 0;
+    bool firing_ = false;
+    bool idle_ = false;  // the timer thread is waiting for a node to be armed
+    bool draining_ = false;  // the destructor is waiting for pendingCount_ and firing_ to drop
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif // INCLUDED_CORO_TIMER_CONTEXT_H
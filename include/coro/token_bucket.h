@@ -0,0 +1,188 @@
+#ifndef INCLUDED_CORO_TOKEN_BUCKET_H
+#define INCLUDED_CORO_TOKEN_BUCKET_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "timer_context.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+
+// token_bucket is a rate limiter whose acquire(n) is awaitable.
+// Tokens accrue continuously at tokensPerSecond, up to a maximum of burst.
+//
+// Like async_semaphore, waiters queue up in FIFO order as intrusive nodes in
+// their own coroutine frames. Nobody sleeps: while anyone is queued, the
+// bucket keeps exactly one timer armed on a timer_context, for the moment
+// the head of the queue will be satisfiable. Waiters are resumed on the
+// timer thread, or inline by acquire() itself when tokens are on hand.
+//
+// tokensPerSecond and burst must be positive, or the constructor throws
+// std::invalid_argument. A request for more than burst tokens could never be
+// satisfied, so acquire() and try_acquire() throw std::invalid_argument
+// instead of queueing it. The bucket must outlive its waiters and its timer; don't destroy it
+// while anyone is still queued.
+
+class token_bucket {
+    class acquire_awaitable;
+    using clock = timer_context::clock;
+public:
+    explicit token_bucket(timer_context& timers, double tokensPerSecond, double burst) :
+        timers_(&timers),
+        rate_(tokensPerSecond),
+        burst_(burst),
+        tokens_(burst),
+        lastRefill_(clock::now())
+    {
+        if (!(tokensPerSecond > 0) || !(burst > 0)) {
+            throw std::invalid_argument("token_bucket: tokensPerSecond and burst must be positive");
+        }
+        timer_.bucket_ = this;
+        timer_.fire_ = [](timer_context::timer_node *node) {
+            static_cast<refill_timer*>(node)->bucket_->on_timer();
+        };
+    }
+
+    token_bucket(const token_bucket&) = delete;
+    token_bucket& operator=(const token_bucket&) = delete;
+
+    acquire_awaitable acquire(size_t n = 1);
+
+    bool try_acquire(size_t n = 1) {
+        check_request(n);
+        std::lock_guard<std::mutex> lock(mut_);
+        refill(clock::now());
+        if (head_ == nullptr && tokens_ >= n) {
+            tokens_ -= n;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    class acquire_awaitable {
+    public:
+        explicit acquire_awaitable(token_bucket *bucket, size_t n) noexcept : bucket_(bucket), n_(n) {}
+
+        bool await_ready() {
+            return bucket_->try_acquire(n_);
+        }
+
+        bool await_suspend(std::coroutine_handle<void> h) {
+            coro_ = h;
+            return bucket_->enqueue(this);
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        friend class token_bucket;
+        token_bucket *bucket_;
+        size_t n_;
+        acquire_awaitable *next_ = nullptr;
+        std::coroutine_handle<void> coro_;
+    };
+
+    struct refill_timer : timer_context::timer_node {
+        token_bucket *bucket_;
+    };
+
+    void check_request(size_t n) const {
+        if (n > burst_) {
+            throw std::invalid_argument("token_bucket: request exceeds the burst size");
+        }
+    }
+
+    void refill(clock::time_point now) {
+        std::chrono::duration<double> elapsed = now - lastRefill_;
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+        lastRefill_ = now;
+    }
+
+    // Called with mut_ held, whenever the head of the queue has changed.
+    void arm_timer_for_head() {
+        if (head_ == nullptr || timerArmed_) {
+            return;
+        }
+        std::chrono::duration<double> wait((head_->n_ - tokens_) / rate_);
+        timer_.deadline_ = lastRefill_ + std::chrono::ceil<clock::duration>(wait);
+        timerArmed_ = true;
+        timers_->arm(&timer_);
+    }
+
+    // Returns true if the caller was queued (and should stay suspended).
+    bool enqueue(acquire_awaitable *w) {
+        std::lock_guard<std::mutex> lock(mut_);
+        refill(clock::now());
+        if (head_ == nullptr && tokens_ >= w->n_) {
+            tokens_ -= w->n_;
+            return false;
+        }
+        if (tail_ != nullptr) {
+            tail_->next_ = w;
+        } else {
+            head_ = w;
+        }
+        tail_ = w;
+        arm_timer_for_head();
+        return true;
+    }
+
+    void on_timer() {
+        acquire_awaitable *ready = nullptr;
+        acquire_awaitable **readyTail = &ready;
+        if (true) {
+            std::lock_guard<std::mutex> lock(mut_);
+            timerArmed_ = false;
+            refill(clock::now());
+            while (head_ != nullptr && head_->n_ <= tokens_) {
+                tokens_ -= head_->n_;
+                *readyTail = head_;
+                readyTail = &head_->next_;
+                head_ = head_->next_;
+            }
+            *readyTail = nullptr;
+            if (head_ == nullptr) {
+                tail_ = nullptr;
+            }
+            arm_timer_for_head();
+        }
+        while (ready != nullptr) {
+            acquire_awaitable *next = ready->next_;
+            ready->coro_.resume();
+            ready = next;
+        }
+    }
+
+    timer_context *timers_;
+    double rate_;
+    double burst_;
+    std::mutex mut_;
+    double tokens_;
+    clock::time_point lastRefill_;
+    acquire_awaitable *head_ = nullptr;
+    acquire_awaitable *tail_ = nullptr;
+    refill_timer timer_;
+    bool timerArmed_ = false;
+};
+
+inline auto token_bucket::acquire(size_t n) -> acquire_awaitable
+{
+    check_request(n);
+    return acquire_awaitable(this, n);
+}
+
+#endif // INCLUDED_CORO_TOKEN_BUCKET_H
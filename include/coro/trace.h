@@ -0,0 +1,363 @@
+#ifndef INCLUDED_CORO_TRACE_H
+#define INCLUDED_CORO_TRACE_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Coroutine lifecycle tracing, exported as Chrome Trace Event JSON (which
+// Perfetto and chrome://tracing both load). Compile with -DCORO_TRACE and
+// task, unique_generator, sync_wait and the executors record events into
+// a ring buffer owned by the recording thread; trace_flush() writes out
+// everything recorded since the last flush. Without the macro, every hook
+// below is an empty inline function and task et al. are unchanged; they
+// don't even include this header, but define the same empty hooks
+// themselves, under the same INCLUDED_CORO_TRACE_HOOKS guard.
+//
+// Each stretch of a coroutine running on a thread is a slice named for the
+// kind of coroutine ("task", "unique_generator", ...), with the frame
+// address in its args. Handing a coroutine to an executor draws a flow
+// arrow from the slice that scheduled it to the slice in which the
+// executor ran it, so scheduling gaps, hops between threads, and time
+// spent queued are all visible. Creation, completion and destruction are
+// instant events.
+//
+// Timestamps come from the TSC (or steady_clock, off x86), calibrated
+// against steady_clock at flush time; they assume an invariant TSC.
+// A full buffer drops new events rather than block, and a dropped suspend
+// leaves its slice open; flush often enough that this doesn't happen.
+// Each thread's buffer (2 MiB) is freed by the first flush after the
+// thread exits, so under thread churn, memory is bounded by the threads
+// that came and went between two flushes.
+
+#ifndef CORO_TRACE
+
+#ifndef INCLUDED_CORO_TRACE_HOOKS
+#define INCLUDED_CORO_TRACE_HOOKS
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // INCLUDED_CORO_TRACE_HOOKS
+
+#else
+
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace trace_detail {
+
+    inline uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    struct record {
+        uint64_t tsc_;
+        const void *frame_;
+        const char *kind_;
+        trace_event event_;
+    };
+
+    // A single-producer, single-consumer ring: the owning thread pushes,
+    // and trace_flush (under the registry's mutex) drains.
+    class buffer {
+    public:
+        static constexpr size_t capacity = size_t(1) << 16;
+
+        explicit buffer(unsigned tid) : tid_(tid), records_(new record[capacity]) {}
+
+        void push(const record& r) noexcept {
+            size_t h = head_.load(std::memory_order_relaxed);
+            if (h - tail_.load(std::memory_order_acquire) == capacity) {
+                dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return;
+            }
+            records_[h % capacity] = r;
+            head_.store(h + 1, std::memory_order_release);
+        }
+
+        template<class F>
+        void drain(F f) {
+            size_t t = tail_.load(std::memory_order_relaxed);
+            size_t h = head_.load(std::memory_order_acquire);
+            for (; t != h; ++t) {
+                f(records_[t % capacity]);
+            }
+            tail_.store(t, std::memory_order_release);
+        }
+
+        size_t take_dropped() noexcept {
+            size_t n = dropped_.load(std::memory_order_relaxed);
+            size_t reported = std::exchange(droppedReported_, n);
+            return n - reported;
+        }
+
+        unsigned tid() const noexcept { return tid_; }
+
+        // Called by the owning thread as it exits, after its last push.
+        void retire() noexcept { retired_.store(true, std::memory_order_release); }
+        bool retired() const noexcept { return retired_.load(std::memory_order_acquire); }
+
+    private:
+        unsigned tid_;
+        std::unique_ptr<record[]> records_;
+        std::atomic<size_t> head_{0};
+        std::atomic<size_t> tail_{0};
+        std::atomic<size_t> dropped_{0};
+        size_t droppedReported_ = 0;
+        std::atomic<bool> retired_{false};
+    };
+
+    // A buffer outlives its thread, so that a flush after join() sees
+    // everything; that flush then frees it.
+    struct registry {
+        std::mutex mut_;
+        std::vector<std::unique_ptr<buffer>> buffers_;
+        unsigned nextTid_ = 1;
+        uint64_t tsc0_ = now();
+        std::chrono::steady_clock::time_point t0_ = std::chrono::steady_clock::now();
+
+        static registry& get() {
+            static registry r;
+            return r;
+        }
+
+        [[gnu::noinline]] buffer *add() {
+            std::lock_guard<std::mutex> lock(mut_);
+            buffers_.push_back(std::make_unique<buffer>(nextTid_++));
+            return buffers_.back().get();
+        }
+    };
+
+    struct local_holder {
+        buffer *b_ = nullptr;
+        ~local_holder() {
+            if (b_ != nullptr) {
+                b_->retire();
+            }
+        }
+    };
+
+    inline buffer& local_buffer() {
+        thread_local local_holder h;
+        if (h.b_ == nullptr) {
+            h.b_ = registry::get().add();
+        }
+        return *h.b_;
+    }
+
+    inline void emit(trace_event e, const char *kind, const void *frame) noexcept {
+        local_buffer().push(record{now(), frame, kind, e});
+    }
+
+    inline void write_event(std::ostream& os, unsigned tid, double ts, const record& r) {
+        os << "{\"pid\":1,\"tid\":" << tid << ",\"ts\":" << ts << ",";
+        switch (r.event_) {
+        case trace_event::create:
+        case trace_event::complete:
+        case trace_event::destroy: {
+            static const char *const verbs[] = {"create ", "", "", "complete ", "destroy "};
+            os << "\"ph\":\"i\",\"s\":\"t\",\"name\":\"" << verbs[int(r.event_)] << r.kind_ << "\"";
+            break;
+        }
+        case trace_event::resume:
+            os << "\"ph\":\"B\",\"name\":\"" << r.kind_ << "\"";
+            break;
+        case trace_event::suspend:
+        case trace_event::run_end:
+            os << "\"ph\":\"E\"}";
+            return;
+        case trace_event::schedule:
+            os << "\"ph\":\"s\",\"cat\":\"schedule\",\"name\":\"" << r.kind_ << "\",\"id\":\"" << r.frame_ << "\"}";
+            return;
+        case trace_event::run_begin:
+            os << "\"ph\":\"B\",\"name\":\"" << r.kind_ << "\"},\n";
+            os << "{\"pid\":1,\"tid\":" << tid << ",\"ts\":" << ts << ",";
+            os << "\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"schedule\",\"name\":\"" << r.kind_ << "\",\"id\":\"" << r.frame_ << "\"}";
+            return;
+        }
+        os << ",\"args\":{\"frame\":\"" << r.frame_ << "\"}}";
+    }
+
+    // co_await x in a traced coroutine awaits a traced_awaiter wrapping x's
+    // awaiter, which ends the current slice when the coroutine really
+    // suspends, and starts a new one when it resumes.
+    template<class A>
+    decltype(auto) get_awaiter(A&& a) {
+        if constexpr (requires { static_cast<A&&>(a).operator co_await(); }) {
+            return static_cast<A&&>(a).operator co_await();
+        } else if constexpr (requires { operator co_await(static_cast<A&&>(a)); }) {
+            return operator co_await(static_cast<A&&>(a));
+        } else {
+            return static_cast<A&&>(a);
+        }
+    }
+
+    template<class Aw>
+    class traced_awaiter {
+    public:
+        explicit traced_awaiter(const char *kind, Aw&& aw) : aw_(static_cast<Aw&&>(aw)), kind_(kind) {}
+
+        bool await_ready() {
+            return aw_.await_ready();
+        }
+
+        // Once aw_.await_suspend has handed off the coroutine, it may already
+        // be running (or gone) elsewhere; only locals are safe to touch.
+        template<class P>
+        auto await_suspend(std::coroutine_handle<P> h) {
+            const char *kind = kind_;
+            void *frame = h.address();
+            frame_ = frame;
+            suspended_ = true;
+            using R = decltype(aw_.await_suspend(h));
+            if constexpr (std::is_void_v<R>) {
+                aw_.await_suspend(h);
+                emit(trace_event::suspend, kind, frame);
+            } else if constexpr (std::is_same_v<R, bool>) {
+                if (aw_.await_suspend(h)) {
+                    emit(trace_event::suspend, kind, frame);
+                    return true;
+                }
+                suspended_ = false;
+                return false;
+            } else {
+                auto next = aw_.await_suspend(h);
+                emit(trace_event::suspend, kind, frame);
+                return next;
+            }
+        }
+
+        decltype(auto) await_resume() {
+            if (suspended_) {
+                emit(trace_event::resume, kind_, frame_);
+            }
+            return aw_.await_resume();
+        }
+
+    private:
+        Aw aw_;
+        const char *kind_;
+        void *frame_ = nullptr;
+        bool suspended_ = false;
+    };
+
+    struct initial_awaiter {
+        const char *kind_;
+        const void *frame_;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<void>) const noexcept {}
+        void await_resume() const noexcept {
+            emit(trace_event::resume, kind_, frame_);
+        }
+    };
+
+} // namespace trace_detail
+
+inline void trace_emit(trace_event e, const char *kind, const void *frame) noexcept
+{
+    trace_detail::emit(e, kind, frame);
+}
+
+// A traced coroutine's first resume starts its first slice.
+inline trace_detail::initial_awaiter trace_initial_suspend(const char *kind, const void *frame) noexcept
+{
+    return trace_detail::initial_awaiter{kind, frame};
+}
+
+template<class A>
+auto trace_await(const char *kind, A&& a)
+{
+    using Aw = decltype(trace_detail::get_awaiter(static_cast<A&&>(a)));
+    return trace_detail::traced_awaiter<Aw>(kind, trace_detail::get_awaiter(static_cast<A&&>(a)));
+}
+
+// Writes every event recorded since the last flush, from every thread,
+// as one Chrome Trace Event JSON document, and frees the buffers of
+// threads that have exited.
+inline void trace_flush(std::ostream& os)
+{
+    auto& reg = trace_detail::registry::get();
+    std::lock_guard<std::mutex> lock(reg.mut_);
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - reg.t0_).count();
+    uint64_t ticks = trace_detail::now() - reg.tsc0_;
+    double ticksPerUs = (us > 0 && ticks > 0) ? ticks / us : 1.0;
+
+    std::ios_base::fmtflags flags = os.flags(std::ios_base::fixed);
+    std::streamsize precision = os.precision(3);
+    const char *sep = "\n";
+    os << "{\"traceEvents\":[";
+    for (auto it = reg.buffers_.begin(); it != reg.buffers_.end(); ) {
+        trace_detail::buffer *b = it->get();
+        bool retired = b->retired();  // before draining, so the drain sees its last push
+        unsigned tid = b->tid();
+        os << sep << "{\"pid\":1,\"tid\":" << tid << ",\"ph\":\"M\",\"name\":\"thread_name\",\"args\":{\"name\":\"thread " << tid << "\"}}";
+        sep = ",\n";
+        b->drain([&](const trace_detail::record& r) {
+            os << sep;
+            trace_detail::write_event(os, tid, double(r.tsc_ - reg.tsc0_) / ticksPerUs, r);
+        });
+        if (size_t n = b->take_dropped()) {
+            os << sep << "{\"pid\":1,\"tid\":" << tid << ",\"ts\":" << us << ",\"ph\":\"i\",\"s\":\"t\",\"name\":\"dropped " << n << " events\"}";
+        }
+        it = retired ? reg.buffers_.erase(it) : it + 1;
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    os.flags(flags);
+    os.precision(precision);
+}
+
+inline bool trace_flush(const char *path)
+{
+    std::ofstream os(path);
+    trace_flush(os);
+    return bool(os);
+}
+
+// Shorthand for a promise's own frame.
+template<class Promise>
+void trace_promise(trace_event e, const char *kind, Promise& p) noexcept
+{
+    trace_emit(e, kind, std::coroutine_handle<Promise>::from_promise(p).address());
+}
+
+#endif // CORO_TRACE
+
+#endif // INCLUDED_CORO_TRACE_H
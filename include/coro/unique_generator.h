@@ -17,6 +17,26 @@ namespace std {
 }
 #endif // __has_include(<coroutine>)
 
+#ifdef CORO_FRAME_PROFILE
+#include "frame_profile.h"
+#endif
+#ifdef CORO_TRACE
+#include "trace.h"
+#elif !defined(INCLUDED_CORO_TRACE_HOOKS)
+#define INCLUDED_CORO_TRACE_HOOKS
+// trace.h's hooks, which do nothing without -DCORO_TRACE.
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // CORO_TRACE
+
 #include <iterator>
 #include <memory>
 #include <utility>
@@ -88,11 +108,18 @@ struct manual_lifetime<void> {
 template<class Ref, class Value = std::decay_t<Ref>>
 class unique_generator {
 public:
-    class promise_type {
+    class promise_type
+#ifdef CORO_FRAME_PROFILE
+        : public frame_profiled<promise_type>
+#endif
+    {
     public:
-        promise_type() noexcept = default;
+        promise_type() noexcept {
+            trace_promise(trace_event::create, "unique_generator", *this);
+        }
 
         ~promise_type() noexcept {
+            trace_promise(trace_event::destroy, "unique_generator", *this);
             clear_value();
         }
 
@@ -174,13 +201,13 @@ public:
 
         iterator& operator++() {
             coro_.promise().clear_value();
-            coro_.resume();
+            unique_generator::resume(coro_);
             return *this;
         }
 
         void operator++(int) {
             coro_.promise().clear_value();
-            coro_.resume();
+            unique_generator::resume(coro_);
         }
 
         friend bool operator==(const iterator& it, sentinel) noexcept { return it.coro_.done(); }
@@ -193,7 +220,7 @@ public:
     };
 
     iterator begin() {
-        coro_.resume();
+        resume(coro_);
         return iterator{coro_};
     }
 
@@ -207,6 +234,16 @@ private:
         coro_(coro)
     {}
 
+    // A generator only ever runs between here and its next co_yield.
+    static void resume(handle_t h) {
+        trace_emit(trace_event::resume, "unique_generator", h.address());
+        h.resume();
+        if (h.done()) {
+            trace_emit(trace_event::complete, "unique_generator", h.address());
+        }
+        trace_emit(trace_event::suspend, "unique_generator", h.address());
+    }
+
     handle_t coro_;
 };
 
@@ -0,0 +1,128 @@
+#ifndef INCLUDED_CORO_WITH_TIMEOUT_H
+#define INCLUDED_CORO_WITH_TIMEOUT_H
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "task.h"
+#include "timer_context.h"
+
+#include <atomic>
+#include <chrono>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+// co_await with_timeout(timers, t, 50ms) runs the task<T> t, and completes
+// with t's value (or exception), or, if t is still running when the timeout
+// expires, with the error timed_out: a task<U, E> awaiting it, with E
+// constructible from timed_out, fails with it in turn; anything else gets a
+// thrown task_error<timed_out>, unless it asks failed() after when_ready().
+//
+// Stopping t is cooperative. On expiry, with_timeout requests a stop on the
+// token that t, and every task t awaits, gets from co_await get_stop_token().
+// It then waits for t to unwind, so t's frame is never destroyed while it's
+// still running; t has timed out even if it finishes normally after that.
+// A with_timeout inside t is stopped along with t.
+//
+// The timeout is a timer_node armed on timers' wheel, so arming it and (when
+// t finishes first) disarming it are both O(1). The timer thread only
+// requests the stop, and never resumes anything: the result is resumed
+// wherever t finishes. (The stop callbacks that the request runs, of t and of
+// anything t awaits, do run on the timer thread; keep them short.) If t
+// finishes just as the timer fires, with_timeout waits there, briefly, for
+// the timer thread to finish requesting the stop.
+
+struct timed_out {};
+
+namespace with_timeout_detail {
+    struct deadline_timer : timer_context::timer_node {
+        std::stop_source source_;
+        std::atomic<bool> fired_{false};
+
+        explicit deadline_timer(timer_context::clock::time_point deadline) {
+            this->deadline_ = deadline;
+            this->fire_ = [](timer_context::timer_node *node) {
+                auto *self = static_cast<deadline_timer*>(node);
+                self->source_.request_stop();
+                self->fired_.store(true, std::memory_order_release);  // the last touch
+            };
+        }
+
+        // For a timer that's too late to disarm: it's already due, so the
+        // timer thread will get to it within its current round.
+        void wait_until_fired() const noexcept {
+            while (!fired_.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    // Hands token down to the tasks the current task awaits, from
+    // co_await enter() until the scope is destroyed.
+    class stop_token_scope {
+    public:
+        explicit stop_token_scope(const std::stop_token *token) noexcept { env_.stopToken_ = token; }
+        stop_token_scope(const stop_token_scope&) = delete;
+        stop_token_scope& operator=(const stop_token_scope&) = delete;
+
+        ~stop_token_scope() {
+            if (promise_ != nullptr) {
+                promise_->pop_env(env_);
+            }
+        }
+
+        struct enter_awaiter {
+            stop_token_scope *scope_;
+
+            bool await_ready() noexcept { return false; }
+
+            template<class P>
+            bool await_suspend(std::coroutine_handle<P> h) noexcept {
+                scope_->promise_ = &h.promise();
+                scope_->promise_->push_env(scope_->env_, h.address());
+                return false;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        enter_awaiter enter() noexcept { return {this}; }
+
+    private:
+        task_detail::task_env env_;
+        task_detail::home_base *promise_ = nullptr;
+    };
+}
+
+template<class T, class Rep, class Period>
+task<T, timed_out> with_timeout(timer_context::executor timers, task<T> t, std::chrono::duration<Rep, Period> timeout)
+{
+    with_timeout_detail::deadline_timer timer(
+        timer_context::clock::now() + std::chrono::ceil<timer_context::clock::duration>(timeout)
+    );
+    std::stop_token outer = co_await get_stop_token();
+    std::stop_callback stopWithOuter(outer, [&]() { timer.source_.request_stop(); });
+    std::stop_token token = timer.source_.get_token();
+    with_timeout_detail::stop_token_scope scope(&token);
+    co_await scope.enter();
+
+    timers.context()->arm(&timer);
+    co_await t.when_ready();
+    if (!timers.context()->disarm(&timer)) {
+        timer.wait_until_fired();
+        co_await error(timed_out{});
+    }
+    co_return t.get();
+}
+
+#endif // INCLUDED_CORO_WITH_TIMEOUT_H
@@ -0,0 +1,539 @@
+#ifndef INCLUDED_CORO_WORK_STEALING_POOL_H
+#define INCLUDED_CORO_WORK_STEALING_POOL_H
+
+// Original source:
+// https://fzn.fr/readings/ppopp13.pdf (Lê, Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory Models")
+
+#if __has_include(<coroutine>)
+#include <coroutine>
+#else
+#include <experimental/coroutine>
+namespace std {
+    using std::experimental::suspend_always;
+    using std::experimental::suspend_never;
+    using std::experimental::noop_coroutine;
+    using std::experimental::coroutine_handle;
+}
+#endif // __has_include(<coroutine>)
+
+#include "executor_metrics.h"
+#include "sync_wait.h"
+#ifdef CORO_TRACE
+#include "trace.h"
+#elif !defined(INCLUDED_CORO_TRACE_HOOKS)
+#define INCLUDED_CORO_TRACE_HOOKS
+// trace.h's hooks, which do nothing without -DCORO_TRACE.
+enum class trace_event : unsigned char {
+    create, resume, suspend, complete, destroy,
+    schedule, run_begin, run_end,
+};
+inline void trace_emit(trace_event, const char *, const void *) noexcept {}
+template<class Promise>
+void trace_promise(trace_event, const char *, Promise&) noexcept {}
+inline std::suspend_always trace_initial_suspend(const char *, const void *) noexcept { return {}; }
+template<class A>
+A&& trace_await(const char *, A&& a) noexcept { return static_cast<A&&>(a); }
+#endif // CORO_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work_stealing_pool models ExecutionContext.
+// It has a .get_executor() method whose result models Executor.
+//
+// Each worker thread owns a bounded Chase-Lev deque of coroutine handles.
+// A worker pushes and pops at the bottom of its own deque (LIFO, for locality),
+// and idle workers steal from the top of other workers' deques (FIFO).
+// Work scheduled from outside the pool, or while the local deque is full,
+// goes through a shared mutex-protected injection queue.
+// Workers with nothing to do park on a condition variable. A worker blocked
+// in sync_wait() runs queued work instead (see sync_wait.h).
+//
+// Latency-sensitive work can instead be scheduled with schedule_by(deadline):
+// it goes into a shared deadline lane, which workers serve earliest deadline
+// first, ahead of everything in the deques and the injection queue. So that
+// a steady stream of deadlines can't starve the other work, a worker that
+// has taken lane_streak_limit lane items in a row takes its next item from
+// elsewhere, if there is one.
+//
+// Each time a worker resumes a coroutine, it gives it a budget of
+// maybe_yield() calls (see maybe_yield.h); the call that exhausts it sends
+// the coroutine to the back of the injection queue, so that a long-running
+// coroutine can't hold a worker forever.
+//
+// metrics() counts work scheduled, resumed and stolen, wakeups, time spent
+// parked, and the latency from schedule() to resumption, in one
+// executor_metrics_shard per worker (plus one for the injection queue and
+// the deadline lane, written under their mutex), and sums the current
+// queue depths.
+//
+// The pool must outlive all the work scheduled on it. Its destructor lets the
+// workers drain every queue, then joins them.
+
+class work_stealing_pool {
+public:
+    class worker;
+
+    explicit work_stealing_pool(size_t threadCount = std::thread::hardware_concurrency()) {
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers_.push_back(std::make_unique<worker>(this, i));
+        }
+        for (auto& w : workers_) {
+            w->thread_ = std::thread([w = w.get()]() { w->run(); });
+        }
+    }
+
+    ~work_stealing_pool() {
+        if (true) {
+            std::lock_guard<std::mutex> lock(mut_);
+            stopping_ = true;
+            cv_.notify_all();
+        }
+        for (auto& w : workers_) {
+            w->thread_.join();
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    size_t thread_count() const noexcept { return workers_.size(); }
+
+    // The worker running on this thread, or nullptr if this thread isn't a pool worker.
+    static worker *current_worker() noexcept { return currentWorker_; }
+
+    bool running_in_this_thread() const noexcept {
+        return currentWorker_ != nullptr && currentWorker_->pool_ == this;
+    }
+
+    // Makes h runnable. From one of this pool's workers, h goes onto that
+    // worker's own deque; from anywhere else, onto the injection queue.
+    void post(std::coroutine_handle<void> h) {
+        trace_emit(trace_event::schedule, "work_stealing_pool", h.address());
+        if (running_in_this_thread() && currentWorker_->deque_.push(h.address())) {
+            executor_metrics_shard::bump(currentWorker_->metrics_.scheduled_);
+            wake_one_if_sleeping();
+            return;
+        }
+        inject(h);
+    }
+
+    // How many maybe_yield() calls (see maybe_yield.h) a coroutine gets, each
+    // time a worker resumes it, before one of them really yields. Default 128.
+    void set_yield_budget(unsigned n) noexcept {
+        yieldBudget_.store(n, std::memory_order_relaxed);
+    }
+
+    // Makes h runnable ahead of all work posted without a deadline,
+    // and of all work posted with a later one.
+    void post_by(std::coroutine_handle<void> h, std::chrono::steady_clock::time_point deadline) {
+        trace_emit(trace_event::schedule, "work_stealing_pool", h.address());
+        if (true) {
+            std::lock_guard<std::mutex> lock(mut_);
+            executor_metrics_shard::bump(injectedMetrics_.scheduled_);
+            lane_.push_back(lane_entry{deadline, laneSeq_++, h});
+            std::push_heap(lane_.begin(), lane_.end(), lane_entry::later);
+            laneCount_.store(lane_.size(), std::memory_order_relaxed);
+        }
+        wake_one_if_sleeping();
+    }
+
+    static constexpr unsigned lane_streak_limit = 16;
+
+    // A bounded single-owner, multi-thief deque of coroutine frame addresses.
+    class work_deque {
+    public:
+        static constexpr int64_t capacity = 8192;
+
+        bool push(void *item) noexcept {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_acquire);
+            if (b - t >= capacity) {
+                return false;
+            }
+            buffer_[b & (capacity - 1)].store(item, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void *pop() noexcept {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            void *item = buffer_[b & (capacity - 1)].load(std::memory_order_relaxed);
+            if (t == b) {
+                // The last item: race any thieves for it.
+                if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        void *steal() noexcept {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b) {
+                return nullptr;
+            }
+            void *item = buffer_[t & (capacity - 1)].load(std::memory_order_relaxed);
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return item;
+        }
+
+        bool empty() const noexcept {
+            return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+        }
+
+        size_t size() const noexcept {
+            int64_t n = bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed);
+            return n > 0 ? size_t(n) : 0;
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> top_{0};
+        alignas(64) std::atomic<int64_t> bottom_{0};
+        std::atomic<void*> buffer_[capacity] = {};
+    };
+
+    class worker {
+    public:
+        explicit worker(work_stealing_pool *pool, size_t index) :
+            pool_(pool), index_(index), rng_(uint32_t(index) * 2654435761u + 1)
+        {}
+
+        work_stealing_pool *pool() const noexcept { return pool_; }
+        size_t index() const noexcept { return index_; }
+
+        // Pushes h onto this worker's deque, where idle workers may steal it.
+        // Must be called on this worker's own thread. Returns false if the deque is full.
+        bool push(std::coroutine_handle<void> h) noexcept {
+            if (deque_.push(h.address())) {
+                executor_metrics_shard::bump(metrics_.scheduled_);
+                pool_->wake_one_if_sleeping();
+                return true;
+            }
+            return false;
+        }
+
+        // Pops the most recently pushed handle, or a null handle.
+        // Must be called on this worker's own thread.
+        std::coroutine_handle<void> pop() noexcept {
+            return std::coroutine_handle<void>::from_address(deque_.pop());
+        }
+
+        // Spends one unit of the running coroutine's yield budget.
+        // Returns true if there was none left to spend.
+        bool spend_budget() noexcept {
+            return budget_ == 0 || --budget_ == 0;
+        }
+
+        // Sends h to the back of the line: the injection queue, behind
+        // everything this worker has queued locally.
+        void yield(std::coroutine_handle<void> h) {
+            trace_emit(trace_event::schedule, "work_stealing_pool", h.address());
+            pool_->inject(h);
+        }
+
+    private:
+        friend class work_stealing_pool;
+
+        std::coroutine_handle<void> find_work() {
+            if (laneStreak_ < lane_streak_limit) {
+                if (auto h = pool_->pop_lane()) {
+                    ++laneStreak_;
+                    return h;
+                }
+            }
+            laneStreak_ = 0;
+            if (auto h = find_unhurried_work()) {
+                return h;
+            }
+            return pool_->pop_lane();
+        }
+
+        std::coroutine_handle<void> find_unhurried_work() {
+            if (void *p = deque_.pop()) {
+                return std::coroutine_handle<void>::from_address(p);
+            }
+            if (pool_->injectedCount_.load(std::memory_order_relaxed) != 0) {
+                std::lock_guard<std::mutex> lock(pool_->mut_);
+                if (!pool_->injected_.empty()) {
+                    auto h = pool_->injected_.front();
+                    pool_->injected_.pop_front();
+                    pool_->injectedCount_.store(pool_->injected_.size(), std::memory_order_relaxed);
+                    return h;
+                }
+            }
+            size_t n = pool_->workers_.size();
+            size_t start = next_random() % n;
+            for (size_t i = 0; i < n; ++i) {
+                worker *victim = pool_->workers_[(start + i) % n].get();
+                if (victim != this) {
+                    if (void *p = victim->deque_.steal()) {
+                        executor_metrics_shard::bump(metrics_.steals_);
+                        return std::coroutine_handle<void>::from_address(p);
+                    }
+                }
+            }
+            return {};
+        }
+
+        bool run_one() {
+            auto h = find_work();
+            if (!h) {
+                return false;
+            }
+            void *frame = h.address();
+            trace_emit(trace_event::run_begin, "work_stealing_pool", frame);
+            executor_metrics_shard::bump(metrics_.resumed_);
+            budget_ = pool_->yieldBudget_.load(std::memory_order_relaxed);
+            h.resume();
+            trace_emit(trace_event::run_end, "work_stealing_pool", frame);
+            return true;
+        }
+
+        void run() {
+            currentWorker_ = this;
+            sync_wait_helper helper{[](void *w) { return static_cast<worker*>(w)->run_one(); }, this};
+            sync_wait_helper::current_ = &helper;
+            while (run_one() || pool_->park()) {
+            }
+            sync_wait_helper::current_ = nullptr;
+            currentWorker_ = nullptr;
+        }
+
+        uint32_t next_random() noexcept {
+            rng_ ^= rng_ << 13;
+            rng_ ^= rng_ >> 17;
+            rng_ ^= rng_ << 5;
+            return rng_;
+        }
+
+        work_stealing_pool *pool_;
+        size_t index_;
+        uint32_t rng_;
+        unsigned laneStreak_ = 0;
+        unsigned budget_ = 0;
+        executor_metrics_shard metrics_;
+        work_deque deque_;
+        std::thread thread_;
+    };
+
+private:
+    class schedule_awaitable {
+    public:
+        explicit schedule_awaitable(work_stealing_pool *pool) noexcept : pool_(pool) {}
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<void> h) {
+            scheduledAt_ = std::chrono::steady_clock::now();
+            pool_->post(h);
+        }
+
+        // Always on one of pool_'s workers.
+        void await_resume() noexcept {
+            currentWorker_->metrics_.record_latency(std::chrono::steady_clock::now() - scheduledAt_);
+        }
+
+    private:
+        work_stealing_pool *pool_;
+        std::chrono::steady_clock::time_point scheduledAt_;
+    };
+
+    class deadline_awaitable {
+    public:
+        explicit deadline_awaitable(work_stealing_pool *pool, std::chrono::steady_clock::time_point deadline) noexcept :
+            pool_(pool), deadline_(deadline) {}
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<void> h) {
+            scheduledAt_ = std::chrono::steady_clock::now();
+            pool_->post_by(h, deadline_);
+        }
+
+        void await_resume() noexcept {
+            currentWorker_->metrics_.record_latency(std::chrono::steady_clock::now() - scheduledAt_);
+        }
+
+    private:
+        work_stealing_pool *pool_;
+        std::chrono::steady_clock::time_point deadline_;
+        std::chrono::steady_clock::time_point scheduledAt_;
+    };
+
+public:
+
+    struct executor {
+    public:
+        explicit executor(work_stealing_pool *pool) noexcept :
+            pool_(pool)
+        {}
+
+        auto schedule() noexcept {
+            return schedule_awaitable(pool_);
+        }
+
+        auto schedule_by(std::chrono::steady_clock::time_point deadline) noexcept {
+            return deadline_awaitable(pool_, deadline);
+        }
+
+        bool running_in_this_thread() const noexcept {
+            return pool_->running_in_this_thread();
+        }
+
+        work_stealing_pool *context() const noexcept { return pool_; }
+
+    private:
+        work_stealing_pool *pool_;
+    };
+
+    executor get_executor() { return executor(this); }
+
+    executor_metrics metrics() const {
+        executor_metrics m;
+        injectedMetrics_.add_to(m);
+        for (auto& w : workers_) {
+            w->metrics_.add_to(m);
+            m.queueDepth_ += w->deque_.size();
+        }
+        m.queueDepth_ += injectedCount_.load(std::memory_order_relaxed);
+        m.queueDepth_ += laneCount_.load(std::memory_order_relaxed);
+        m.threadsStarted_ = workers_.size();
+        m.liveThreads_ = workers_.size();
+        return m;
+    }
+
+private:
+    bool any_work_visible() const noexcept {
+        if (injectedCount_.load(std::memory_order_relaxed) != 0 || laneCount_.load(std::memory_order_relaxed) != 0) {
+            return true;
+        }
+        for (auto& w : workers_) {
+            if (!w->deque_.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void inject(std::coroutine_handle<void> h) {
+        if (true) {
+            std::lock_guard<std::mutex> lock(mut_);
+            executor_metrics_shard::bump(injectedMetrics_.scheduled_);
+            injected_.push_back(h);
+            injectedCount_.store(injected_.size(), std::memory_order_relaxed);
+        }
+        wake_one_if_sleeping();
+    }
+
+    std::coroutine_handle<void> pop_lane() {
+        if (laneCount_.load(std::memory_order_relaxed) == 0) {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(mut_);
+        if (lane_.empty()) {
+            return {};
+        }
+        std::pop_heap(lane_.begin(), lane_.end(), lane_entry::later);
+        auto h = lane_.back().coro_;
+        lane_.pop_back();
+        laneCount_.store(lane_.size(), std::memory_order_relaxed);
+        return h;
+    }
+
+    // Called by pushers after making work visible.
+    void wake_one_if_sleeping() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) != 0) {
+            std::lock_guard<std::mutex> lock(mut_);
+            if (wakeups_ < sleeping_.load(std::memory_order_relaxed)) {
+                executor_metrics_shard::bump(injectedMetrics_.wakeups_);
+                ++wakeups_;
+                cv_.notify_one();
+            }
+        }
+    }
+
+    // Parks the calling worker until there might be work for it.
+    // Returns false when the pool is shutting down and the worker should exit.
+    bool park() {
+        sleeping_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (any_work_visible()) {
+            sleeping_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        std::unique_lock<std::mutex> lk(mut_);
+        if (wakeups_ == 0 && !stopping_) {
+            auto start = std::chrono::steady_clock::now();
+            do {
+                cv_.wait(lk);
+            } while (wakeups_ == 0 && !stopping_);
+            executor_metrics_shard& m = currentWorker_->metrics_;
+            executor_metrics_shard::bump(m.parks_);
+            executor_metrics_shard::bump(m.parkedNs_, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+        bool keepGoing = true;
+        if (wakeups_ != 0) {
+            --wakeups_;
+        } else {
+            keepGoing = any_work_visible();
+        }
+        sleeping_.fetch_sub(1, std::memory_order_relaxed);
+        return keepGoing;
+    }
+
+    static inline thread_local worker *currentWorker_ = nullptr;
+
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::mutex mut_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<void>> injected_;
+    std::atomic<size_t> injectedCount_{0};
+    executor_metrics_shard injectedMetrics_;
+
+    // A min-heap on deadline, then on order of arrival.
+    struct lane_entry {
+        std::chrono::steady_clock::time_point deadline_;
+        uint64_t seq_;
+        std::coroutine_handle<void> coro_;
+
+        static bool later(const lane_entry& a, const lane_entry& b) noexcept {
+            return a.deadline_ != b.deadline_ ? a.deadline_ > b.deadline_ : a.seq_ > b.seq_;
+        }
+    };
+    std::vector<lane_entry> lane_;
+    uint64_t laneSeq_ = 0;
+    std::atomic<size_t> laneCount_{0};
+    std::atomic<unsigned> yieldBudget_{128};
+    std::atomic<size_t> sleeping_{0};
+    size_t wakeups_ = 0;
+    bool stopping_ = false;
+};
+
+#endif // INCLUDED_CORO_WORK_STEALING_POOL_H
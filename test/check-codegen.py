@@ -0,0 +1,84 @@
+#!/usr/bin/env python
+
+# Compiles each file to assembly with $CXX (default c++) at -O2, and checks
+# that no function named hot_* can reach a heap allocation: a call to
+# operator new or malloc, directly or through any function defined in the
+# same file. Functions whose names contain "_slow" are deliberate escape
+# hatches (e.g. an arena's overflow path) and are not followed.
+# Functions named probe_* get the same analysis, but are only reported:
+# an allocation there is information, not a failure.
+
+from __future__ import print_function
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+ALLOCATORS = re.compile(r'^(_Znwm|_Znam|_ZnwmSt11align_val_t|_ZnamSt11align_val_t|malloc|calloc|realloc)(@PLT)?$')
+LABEL = re.compile(r'^([A-Za-z_.$][\w.$]*):')
+CALL = re.compile(r'^\s+(?:call|jmp)q?\s+\*?([A-Za-z_.$][\w.$@]*)')
+
+
+def compile_to_asm(cxx, fname):
+    cmd = [cxx, '-std=c++2a', '-O2', '-S', '-o', '-', fname]
+    return subprocess.check_output(cmd).decode('utf-8')
+
+
+def parse_functions(asm):
+    functions = {}
+    current = None
+    for line in asm.splitlines():
+        m = LABEL.match(line)
+        if m is not None and not m.group(1).startswith('.L'):
+            current = m.group(1)
+            functions.setdefault(current, [])
+        elif current is not None:
+            m = CALL.match(line)
+            if m is not None:
+                functions[current].append(m.group(1))
+    return functions
+
+
+def path_to_allocator(functions, root):
+    # Depth-first search for a call chain from root to an allocator.
+    stack = [(root, [root])]
+    seen = set()
+    while stack:
+        fn, path = stack.pop()
+        if fn in seen:
+            continue
+        seen.add(fn)
+        for callee in functions.get(fn, []):
+            if ALLOCATORS.match(callee):
+                return path + [callee]
+            name = callee.split('@')[0]
+            if name in functions and '_slow' not in name:
+                stack.append((name, path + [name]))
+    return None
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser()
+    parser.add_argument('files', nargs='+', metavar='FILE')
+    options = parser.parse_args()
+
+    cxx = os.environ.get('CXX', 'c++')
+    failed = False
+    for fname in options.files:
+        functions = parse_functions(compile_to_asm(cxx, fname))
+        roots = sorted(f for f in functions if 'hot_' in f or 'probe_' in f)
+        if not roots:
+            print('%s: no hot_* or probe_* functions found' % fname)
+            failed = True
+        for root in roots:
+            path = path_to_allocator(functions, root)
+            if path is None:
+                print('%s: %s: ok' % (fname, root))
+            elif 'probe_' in root:
+                print('%s: %s: allocates (reported only)' % (fname, root))
+            else:
+                print('%s: %s: allocates via %s' % (fname, root, ' -> '.join(path)))
+                failed = True
+    sys.exit(1 if failed else 0)
@@ -0,0 +1,41 @@
+// Every function named hot_* must not reach operator new or malloc,
+// except through the arena's out-of-line overflow path. The frames are
+// arena-backed, not elided: hot_* still takes them from frame_arena.
+// Checked by "make codegen" (test/check-codegen.py).
+
+#include "../../include/coro/co_expected.h"
+
+enum class parse_error { bad_digit, overflow };
+
+static co_expected<int, parse_error> digit(char c)
+{
+    if (c < '0' || c > '9') {
+        return unexpected(parse_error::bad_digit);
+    }
+    return c - '0';
+}
+
+static co_expected<int, parse_error> two_digits(const char *s)
+{
+    int a = co_await digit(s[0]);
+    int b = co_await digit(s[1]);
+    co_return 10 * a + b;
+}
+
+static co_expected<int, parse_error> four_digits(const char *s)
+{
+    int hi = co_await two_digits(s);
+    co_expected<int, parse_error> lo = two_digits(s + 2);
+    co_return 100 * hi + co_await lo;
+}
+
+int hot_two_digits(const char *s)
+{
+    return two_digits(s).value_or(-1);
+}
+
+int hot_four_digits(const char *s)
+{
+    co_expected<int, parse_error> r = four_digits(s);
+    return r.has_value() ? *r : -int(r.error());
+}
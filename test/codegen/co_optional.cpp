@@ -0,0 +1,61 @@
+// Chains of 1 to 10 co_await steps over co_optional (probe_co_chain_N),
+// beside the same chains hand-written with early returns (hot_plain_chain_N).
+// The hand-written chains must never allocate; for the co_optional chains,
+// "make codegen" reports whether this compiler heap-allocates the frame,
+// which is what decides whether co_optional belongs on a given hot path.
+
+#include "../../include/coro/co_optional.h"
+#include <optional>
+
+static co_optional<int> co_step(int x, int i)
+{
+    if ((x ^ i) % 1000 == 999) {
+        return std::nullopt;
+    }
+    return x + i;
+}
+
+static std::optional<int> plain_step(int x, int i)
+{
+    if ((x ^ i) % 1000 == 999) {
+        return std::nullopt;
+    }
+    return x + i;
+}
+
+template<int N>
+static co_optional<int> co_chain(int x)
+{
+    for (int i = 0; i < N; ++i) {
+        x = co_await co_step(x, i);
+    }
+    co_return x;
+}
+
+template<int N>
+static std::optional<int> plain_chain(int x)
+{
+    for (int i = 0; i < N; ++i) {
+        std::optional<int> r = plain_step(x, i);
+        if (!r) {
+            return std::nullopt;
+        }
+        x = *r;
+    }
+    return x;
+}
+
+#define CHAIN(N) \
+    int probe_co_chain_##N(int x) { return co_chain<N>(x).value_or(-1); } \
+    int hot_plain_chain_##N(int x) { return plain_chain<N>(x).value_or(-1); }
+
+CHAIN(1)
+CHAIN(2)
+CHAIN(3)
+CHAIN(4)
+CHAIN(5)
+CHAIN(6)
+CHAIN(7)
+CHAIN(8)
+CHAIN(9)
+CHAIN(10)
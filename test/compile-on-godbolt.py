@@ -8,21 +8,34 @@ import requests
 import sys
 
 
-def preprocess_file(fname):
+def preprocess_file(fname, already_included=None):
+    # Headers may #include "sibling.h" one another; inline each of those
+    # at most once, since Compiler Explorer can't see our local files.
+    if already_included is None:
+        already_included = set()
     result = ''
     try:
         with open(fname, 'r') as f:
             for line in f.readlines():
                 m = re.match(r'#include <https://raw.githubusercontent.com/Quuxplusone/coro/master/(.*)>', line)
+                q = re.match(r'#include "(.*)"', line)
                 if m is not None:
-                    with open(os.path.dirname(fname) + '/../' + m.group(1)) as h:
-                        result += h.read() + '\n'
+                    result += include_file(os.path.dirname(fname) + '/../' + m.group(1), already_included)
+                elif q is not None:
+                    result += include_file(os.path.dirname(fname) + '/' + q.group(1), already_included)
                 else:
                     result += line.rstrip() + '\n'
         return result
     except RuntimeError as e:
         raise RuntimeError(str(e) + ' in ' + fname)
 
+def include_file(fname, already_included):
+    fname = os.path.abspath(fname)
+    if fname in already_included:
+        return ''
+    already_included.add(fname)
+    return preprocess_file(fname, already_included) + '\n'
+
 def fetch_godbolt_include_option(library, version):
     info = requests.get(
         'https://godbolt.org/api/libraries/c++',